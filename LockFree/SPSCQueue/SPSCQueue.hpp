@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "SPSCQueueWait.hpp"
+
+// Размер линии кэша, фиксирован, чтобы раскладка очереди не зависела от
+// версии компилятора и -mtune
+const size_t SPSC_QUEUE_CACHE_LINE_SIZE = 64;
+
+// https://habr.com/ru/articles/963818/
+// https://github.com/rigtorp/SPSCQueue
+//
+// Каждый индекс лежит в своей линии кэша. Producer хранит локальную копию
+// readPos (readPosCache), consumer - копию writePos (writePosCache), и
+// чужой индекс читается только когда очередь по копии выглядит полной или
+// пустой, поэтому линии индексов не гоняются между ядрами на каждой
+// операции.
+//
+// Если Size - степень двойки, индексы растут без ограничения и переводятся
+// в позицию маской: используются все Size ячеек и на операцию нет деления.
+// Для остальных Size индексы берутся по модулю, и одна ячейка остается
+// пустой, чтобы отличить полную очередь от пустой. Вариант выбирается при
+// компиляции.
+//
+// Ячейки - неинициализированная память: элемент создается на месте в
+// push/emplace и разрушается в pop, поэтому T не обязан иметь конструктор
+// по умолчанию. front() дает consumer'у элемент без копирования, pop()
+// затем освобождает ячейку.
+//
+// push_n/pop_n переносят пачку элементов не более чем двумя непрерывными
+// участками (до конца буфера и с его начала) и публикуют ее одним
+// release-store. Для тривиально копируемых T участок копируется memcpy.
+//
+// pop_wait ждет элемент по стратегии Wait (SPSCQueueWait.hpp): от чистого
+// spin до сна на futex или eventfd. Стратегия по умолчанию ничего не
+// добавляет к push.
+//
+// Producer: push, emplace, push_n
+// Consumer: pop(T&), front + pop(), pop_n, pop_wait
+template <typename T, size_t Size, typename Wait = SPSCSpinWait>
+class SPSCQueue {
+  static_assert(Size > 0, "SPSCQueue needs at least one slot");
+
+ public:
+  SPSCQueue() = default;
+  ~SPSCQueue() {
+    while (front() != nullptr) {
+      pop();
+    }
+  }
+
+  SPSCQueue(const SPSCQueue&) = delete;
+  SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+  // Сколько элементов помещается в очередь одновременно
+  static constexpr size_t capacity() { return POWER_OF_TWO ? Size : Size - 1; }
+
+  bool push(const T& value) { return emplace(value); }
+  bool push(T&& value) { return emplace(std::move(value)); }
+
+  template <typename... Args>
+  bool emplace(Args&&... args) {
+    size_t currentWrite = writePos.load(std::memory_order_relaxed);
+
+    // Проверка на полноту очереди, сначала по локальной копии
+    if (full(currentWrite, readPosCache)) {
+      readPosCache = readPos.load(std::memory_order_acquire);
+      if (full(currentWrite, readPosCache)) {
+        return false;  // Очередь полна
+      }
+    }
+
+    std::construct_at(rawSlot(currentWrite), std::forward<Args>(args)...);
+
+    // Release гарантирует, что запись в ячейку видна consumer'у
+    writePos.store(advance(currentWrite), std::memory_order_release);
+    waiter.notify();
+    return true;
+  }
+
+  // Записывает до n элементов из values, возвращает сколько поместилось
+  size_t push_n(const T* values, size_t n) {
+    size_t currentWrite = writePos.load(std::memory_order_relaxed);
+
+    size_t space = capacity() - used(currentWrite, readPosCache);
+    if (space < n) {
+      readPosCache = readPos.load(std::memory_order_acquire);
+      space = capacity() - used(currentWrite, readPosCache);
+    }
+
+    n = std::min(n, space);
+    if (n == 0) {
+      return 0;
+    }
+
+    const size_t head = std::min(n, Size - slot(currentWrite));
+    copyIn(rawSlot(currentWrite), values, head);
+    try {
+      copyIn(rawSlot(0), values + head, n - head);
+    } catch (...) {
+      std::destroy_n(rawSlot(currentWrite), head);
+      throw;
+    }
+
+    // Один release на всю пачку
+    writePos.store(advance(currentWrite, n), std::memory_order_release);
+    waiter.notify();
+    return n;
+  }
+
+  // Переносит до max элементов в out, возвращает сколько
+  size_t pop_n(T* out, size_t max) {
+    size_t currentRead = readPos.load(std::memory_order_relaxed);
+
+    size_t available = used(writePosCache, currentRead);
+    if (available < max) {
+      writePosCache = writePos.load(std::memory_order_acquire);
+      available = used(writePosCache, currentRead);
+    }
+
+    const size_t n = std::min(max, available);
+    if (n == 0) {
+      return 0;
+    }
+
+    const size_t head = std::min(n, Size - slot(currentRead));
+    moveOut(out, rawSlot(currentRead), head);
+    moveOut(out + head, rawSlot(0), n - head);
+
+    // Один release на всю пачку
+    readPos.store(advance(currentRead, n), std::memory_order_release);
+    return n;
+  }
+
+  bool pop(T& result) {
+    T* item = front();
+    if (item == nullptr) {
+      return false;  // Очередь пуста
+    }
+
+    result = std::move(*item);
+    pop();
+    return true;
+  }
+
+  // Ждет элемент по стратегии Wait и извлекает его
+  void pop_wait(T& result) {
+    waiter.wait([this] { return front() != nullptr; });
+    pop(result);
+  }
+
+  // Ожидание вне очереди, например Reactor c SPSCEventFdWait: false, если
+  // элементы уже есть, иначе ждать wait_strategy().handle()
+  bool arm_wait()
+    requires requires(Wait& w) { w.arm([] { return true; }); }
+  {
+    return waiter.arm([this] { return front() != nullptr; });
+  }
+
+  Wait& wait_strategy() noexcept { return waiter; }
+
+  // Первый элемент без извлечения, nullptr если очередь пуста
+  T* front() {
+    size_t currentRead = readPos.load(std::memory_order_relaxed);
+
+    // Проверка на пустоту очереди, сначала по локальной копии
+    if (currentRead == writePosCache) {
+      writePosCache = writePos.load(std::memory_order_acquire);
+      if (currentRead == writePosCache) {
+        return nullptr;
+      }
+    }
+
+    return slotPtr(currentRead);
+  }
+
+  // Удаляет элемент, полученный через front(), очередь не должна быть пуста
+  void pop() {
+    size_t currentRead = readPos.load(std::memory_order_relaxed);
+    assert(currentRead != writePos.load(std::memory_order_acquire));
+
+    std::destroy_at(slotPtr(currentRead));
+
+    // Release синхронизирует с producer
+    readPos.store(advance(currentRead), std::memory_order_release);
+  }
+
+  // Число элементов, из третьего потока - только оценка
+  size_t size_approx() const {
+    // readPos первым: writePos не может оказаться меньше прочитанного
+    size_t read = readPos.load(std::memory_order_acquire);
+    size_t write = writePos.load(std::memory_order_acquire);
+
+    return std::min(used(write, read), capacity());
+  }
+
+ private:
+  static constexpr bool POWER_OF_TWO = (Size & (Size - 1)) == 0;
+
+  static size_t slot(size_t pos) {
+    if constexpr (POWER_OF_TWO) {
+      return pos & (Size - 1);
+    } else {
+      return pos;
+    }
+  }
+
+  static size_t advance(size_t pos, size_t count = 1) {
+    if constexpr (POWER_OF_TWO) {
+      return pos + count;
+    } else {
+      return (pos + count) % Size;
+    }
+  }
+
+  static size_t used(size_t write, size_t read) {
+    if constexpr (POWER_OF_TWO) {
+      return write - read;
+    } else {
+      return (write + Size - read) % Size;
+    }
+  }
+
+  static bool full(size_t write, size_t read) {
+    return used(write, read) == capacity();
+  }
+
+  static void copyIn(T* dst, const T* src, size_t count) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (count != 0) {
+        std::memcpy(static_cast<void*>(dst), src, count * sizeof(T));
+      }
+    } else {
+      std::uninitialized_copy_n(src, count, dst);
+    }
+  }
+
+  static void moveOut(T* dst, T* src, size_t count) {
+    if constexpr (std::is_trivially_copyable_v<T>) {
+      if (count != 0) {
+        std::memcpy(static_cast<void*>(dst), src, count * sizeof(T));
+      }
+    } else {
+      for (size_t i = 0; i < count; ++i) {
+        T* item = std::launder(src + i);
+        dst[i] = std::move(*item);
+        std::destroy_at(item);
+      }
+    }
+  }
+
+  // Ячейка под новый элемент
+  T* rawSlot(size_t pos) { return reinterpret_cast<T*>(storage) + slot(pos); }
+  // Ячейка с живым элементом
+  T* slotPtr(size_t pos) { return std::launder(rawSlot(pos)); }
+
+  // Producer
+  alignas(SPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> writePos{0};
+  alignas(SPSC_QUEUE_CACHE_LINE_SIZE) size_t readPosCache = 0;
+
+  // Consumer
+  alignas(SPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> readPos{0};
+  alignas(SPSC_QUEUE_CACHE_LINE_SIZE) size_t writePosCache = 0;
+
+  alignas(SPSC_QUEUE_CACHE_LINE_SIZE) alignas(T) std::byte
+      storage[Size * sizeof(T)];
+
+  // Producer читает на каждый push, consumer пишет только засыпая
+  [[no_unique_address]] Wait waiter;
+};
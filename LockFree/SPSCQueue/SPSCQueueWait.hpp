@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <system_error>
+#endif
+
+// Стратегии ожидания consumer'а для SPSCQueue::pop_wait.
+//
+// Стратегия получает два вызова:
+//  - notify() - producer после публикации элемента
+//  - wait(ready) - consumer, возвращается когда ready() == true
+//
+// SPSCSpinWait и SPSCSpinYieldWait не хранят состояния, notify() пуст, и
+// push стоит столько же, сколько без стратегии. Минимальная задержка,
+// но consumer занимает ядро.
+//
+// SPSCAtomicWait и SPSCEventFdWait усыпляют consumer'а. Consumer поднимает
+// флаг waiting и перепроверяет очередь, producer после публикации читает
+// флаг и будит только если consumer спит, иначе платит барьером и одной
+// загрузкой. Барьеры seq_cst с обеих сторон гарантируют, что либо consumer
+// увидит элемент, либо producer увидит флаг.
+//
+// SPSCEventFdWait дает дескриптор, который может ждать Reactor (epoll,
+// poll) вместо потока в pop_wait: arm(ready) поднимает флаг, после
+// готовности дескриптора reset() сбрасывает счетчик eventfd.
+
+struct SPSCSpinWait {
+  void notify() noexcept {}
+
+  template <typename Ready>
+  void wait(Ready ready) {
+    while (!ready()) {
+    }
+  }
+};
+
+// Spins, затем уступает процессор
+template <unsigned Spins = 1024>
+struct SPSCSpinYieldWait {
+  void notify() noexcept {}
+
+  template <typename Ready>
+  void wait(Ready ready) {
+    for (unsigned i = 0; i < Spins; ++i) {
+      if (ready()) {
+        return;
+      }
+    }
+    while (!ready()) {
+      std::this_thread::yield();
+    }
+  }
+};
+
+// Futex через std::atomic::wait/notify_one
+class SPSCAtomicWait {
+ public:
+  void notify() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) &&
+        waiting.exchange(false, std::memory_order_relaxed)) {
+      epoch.fetch_add(1, std::memory_order_relaxed);
+      epoch.notify_one();
+    }
+  }
+
+  template <typename Ready>
+  void wait(Ready ready) {
+    while (!ready()) {
+      // Эпоха читается до флага: пробуждение после этого ее изменит
+      uint32_t current = epoch.load(std::memory_order_relaxed);
+      waiting.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+
+      if (!ready()) {
+        epoch.wait(current, std::memory_order_relaxed);
+      }
+      waiting.store(false, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  std::atomic<bool> waiting{false};
+  std::atomic<uint32_t> epoch{0};
+};
+
+#if defined(__linux__)
+// Пробуждение через eventfd, который также может ждать Reactor
+class SPSCEventFdWait {
+ public:
+  SPSCEventFdWait() : fd(eventfd(0, EFD_CLOEXEC)) {
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+  }
+  ~SPSCEventFdWait() { close(fd); }
+
+  SPSCEventFdWait(const SPSCEventFdWait&) = delete;
+  SPSCEventFdWait& operator=(const SPSCEventFdWait&) = delete;
+
+  void notify() noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) &&
+        waiting.exchange(false, std::memory_order_relaxed)) {
+      uint64_t one = 1;
+      // Ошибка невозможна, пока счетчик не переполнен
+      (void)!write(fd, &one, sizeof(one));
+    }
+  }
+
+  template <typename Ready>
+  void wait(Ready ready) {
+    while (!ready()) {
+      if (arm(ready)) {
+        reset();
+      }
+    }
+  }
+
+  // Дескриптор для Reactor, готов на чтение после notify()
+  [[nodiscard]] int handle() const noexcept { return fd; }
+
+  // Поднимает флаг перед ожиданием handle(), false если ready() уже true
+  // и ждать не нужно
+  template <typename Ready>
+  bool arm(Ready ready) {
+    waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (ready()) {
+      // Если producer уже снял флаг, в eventfd останется лишнее
+      // пробуждение, оно безвредно: ready() перепроверяется
+      waiting.store(false, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  // Блокирует до notify() и сбрасывает счетчик eventfd
+  void reset() noexcept {
+    uint64_t count = 0;
+    while (read(fd, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+  }
+
+ private:
+  std::atomic<bool> waiting{false};
+  int fd;
+};
+#endif
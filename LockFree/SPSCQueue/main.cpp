@@ -1,53 +1,24 @@
 // https://habr.com/ru/articles/963818/
+#include "SPSCQueue.hpp"
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <chrono>
 #include <cstring>
+#include <ctime>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <numeric>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
-template <typename T, size_t Size>
-class SPSCQueue {
- private:
-  std::array<T, Size> buffer;
-  std::atomic<size_t> writePos{0};
-  std::atomic<size_t> readPos{0};
-
- public:
-  bool push(const T& value) {
-    size_t currentWrite = writePos.load(std::memory_order_relaxed);
-    size_t nextWrite = (currentWrite + 1) % Size;
-
-    // Проверка на полноту очереди
-    if (nextWrite == readPos.load(std::memory_order_acquire)) {
-      return false;  // Очередь полна
-    }
-
-    buffer[currentWrite] = value;
-
-    // Release гарантирует, что запись в buffer видна consumer'у
-    writePos.store(nextWrite, std::memory_order_release);
-    return true;
-  }
-
-  bool pop(T& result) {
-    size_t currentRead = readPos.load(std::memory_order_relaxed);
-
-    // Проверка на пустоту очереди
-    if (currentRead == writePos.load(std::memory_order_acquire)) {
-      return false;  // Очередь пуста
-    }
-
-    result = buffer[currentRead];
-
-    // Release синхронизирует с producer
-    readPos.store((currentRead + 1) % Size, std::memory_order_release);
-    return true;
-  }
-};
-
 // Demo 1: Basic Usage
 void demo_basic_usage() {
   std::cout << "=== Demo 1: Basic Usage ===\n";
@@ -114,10 +85,15 @@ void demo_producer_consumer() {
     int count = 0;
     std::vector<int> received;
 
-    while (!done.load() || queue.pop(value)) {
+    while (true) {
+      // done is read before pop: once it is set, a failed pop means every
+      // item was consumed
+      bool finished = done.load();
       if (queue.pop(value)) {
         received.push_back(value);
         count++;
+      } else if (finished) {
+        break;
       } else {
         std::this_thread::yield();
       }
@@ -136,19 +112,52 @@ void demo_producer_consumer() {
   std::cout << "\n";
 }
 
-// Demo 4: Performance Measurement
-void demo_performance() {
-  std::cout << "=== Demo 4: Performance Measurement ===\n";
+// Original layout for comparison: indices next to the buffer and the other
+// side's index loaded with acquire on every push and pop. Free-running
+// indices masked to a power of two Size, as SPSCQueue does, so only the
+// layout and the caching differ.
+template <typename T, size_t Size>
+class UncachedSPSCQueue {
+  static_assert((Size & (Size - 1)) == 0, "Size must be a power of two");
+
+ private:
+  std::array<T, Size> buffer;
+  std::atomic<size_t> writePos{0};
+  std::atomic<size_t> readPos{0};
+
+ public:
+  bool push(const T& value) {
+    size_t currentWrite = writePos.load(std::memory_order_relaxed);
+    if (currentWrite - readPos.load(std::memory_order_acquire) == Size) {
+      return false;
+    }
+    buffer[currentWrite & (Size - 1)] = value;
+    writePos.store(currentWrite + 1, std::memory_order_release);
+    return true;
+  }
 
-  const size_t ITEMS = 1000000;
-  SPSCQueue<int, 1024> queue;
+  bool pop(T& result) {
+    size_t currentRead = readPos.load(std::memory_order_relaxed);
+    if (currentRead == writePos.load(std::memory_order_acquire)) {
+      return false;
+    }
+    result = buffer[currentRead & (Size - 1)];
+    readPos.store(currentRead + 1, std::memory_order_release);
+    return true;
+  }
+};
+
+// Moves items integers through Queue, returns the duration in milliseconds
+template <typename Queue>
+double measure_transfer(size_t items) {
+  auto queue = std::make_unique<Queue>();
   std::atomic<bool> done{false};
 
   auto start = std::chrono::high_resolution_clock::now();
 
-  std::thread producer([&queue, &done]() {
-    for (size_t i = 0; i < ITEMS; ++i) {
-      while (!queue.push(static_cast<int>(i))) {
+  std::thread producer([&queue, &done, items]() {
+    for (size_t i = 0; i < items; ++i) {
+      while (!queue->push(static_cast<int>(i))) {
         std::this_thread::yield();
       }
     }
@@ -159,9 +168,12 @@ void demo_performance() {
     int value;
     size_t count = 0;
 
-    while (!done.load() || queue.pop(value)) {
-      if (queue.pop(value)) {
+    while (true) {
+      bool finished = done.load();
+      if (queue->pop(value)) {
         count++;
+      } else if (finished) {
+        break;
       } else {
         std::this_thread::yield();
       }
@@ -172,17 +184,82 @@ void demo_performance() {
   consumer.join();
 
   auto end = std::chrono::high_resolution_clock::now();
-  auto duration =
-      std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Demo 4: Performance Measurement
+void demo_performance() {
+  std::cout << "=== Demo 4: Performance Measurement ===\n";
+
+  const size_t ITEMS = 10000000;
+
+  auto report = [ITEMS](const char* layout, double ms) {
+    std::cout << layout << ": transferred " << ITEMS << " items in " << ms
+              << " ms, throughput: " << (ITEMS * 1000.0 / ms)
+              << " items/sec\n";
+  };
+
+  report("Shared index lines  ",
+         measure_transfer<UncachedSPSCQueue<int, 1024>>(ITEMS));
+  report("Cached remote index ", measure_transfer<SPSCQueue<int, 1024>>(ITEMS));
+  std::cout << "\n";
+}
+
+// Keeps the measured loops from being optimised away
+volatile long long benchmark_sink = 0;
+
+// Fills the queue to capacity and drains it, rounds times, on one thread so
+// only the index arithmetic differs; returns nanoseconds per operation
+template <typename Queue>
+double measure_push_pop(size_t rounds) {
+  auto queue = std::make_unique<Queue>();
+  long long sum = 0;
+  int value;
 
-  std::cout << "Transferred " << ITEMS << " items in " << duration.count()
+  auto start = std::chrono::high_resolution_clock::now();
+
+  for (size_t r = 0; r < rounds; ++r) {
+    for (size_t i = 0; i < Queue::capacity(); ++i) {
+      queue->push(static_cast<int>(i));
+    }
+    while (queue->pop(value)) {
+      sum += value;
+    }
+  }
+
+  auto end = std::chrono::high_resolution_clock::now();
+
+  benchmark_sink = sum;
+
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         static_cast<double>(rounds * Queue::capacity() * 2);
+}
+
+// Demo 5: Power of Two Masking vs Modulo Indexing
+void demo_index_math() {
+  std::cout << "=== Demo 5: Power of Two Masking vs Modulo Indexing ===\n";
+
+  // Same usable capacity: the modulo queue keeps one slot empty
+  using MaskQueue = SPSCQueue<int, 1024>;
+  using ModuloQueue = SPSCQueue<int, 1025>;
+  const size_t ROUNDS = 20000;
+  const size_t ITEMS = 10000000;
+
+  std::cout << "Single thread push/pop, capacity " << MaskQueue::capacity()
+            << ":\n";
+  std::cout << "  Mask   : " << measure_push_pop<MaskQueue>(ROUNDS)
+            << " ns/op\n";
+  std::cout << "  Modulo : " << measure_push_pop<ModuloQueue>(ROUNDS)
+            << " ns/op\n";
+
+  std::cout << "Producer-consumer transfer of " << ITEMS << " items:\n";
+  std::cout << "  Mask   : " << measure_transfer<MaskQueue>(ITEMS) << " ms\n";
+  std::cout << "  Modulo : " << measure_transfer<ModuloQueue>(ITEMS)
             << " ms\n";
-  std::cout << "Throughput: " << (ITEMS * 1000.0 / duration.count())
-            << " items/sec\n";
   std::cout << "\n";
 }
 
-// Demo 5: Custom Data Types
+// Demo 6: Custom Data Types
 struct Message {
   int id;
   double value;
@@ -195,7 +272,7 @@ struct Message {
 };
 
 void demo_custom_types() {
-  std::cout << "=== Demo 5: Custom Data Types ===\n";
+  std::cout << "=== Demo 6: Custom Data Types ===\n";
 
   SPSCQueue<Message, 10> queue;
 
@@ -210,6 +287,203 @@ void demo_custom_types() {
     std::cout << "Message[" << msg.id << "]: " << msg.value << ", \""
               << msg.text.data() << "\"\n";
   }
+
+  // Message is trivially copyable, so batches are copied with memcpy
+  static_assert(std::is_trivially_copyable_v<Message>);
+  std::array<Message, 12> batch;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    batch[i] = Message(static_cast<int>(i + 4), 0.5 * i, "Batch");
+  }
+
+  size_t pushed = queue.push_n(batch.data(), batch.size());
+  std::cout << "Pushed " << pushed << " of " << batch.size()
+            << " messages in one batch\n";
+
+  std::array<Message, 4> received;
+  size_t count;
+  while ((count = queue.pop_n(received.data(), received.size())) != 0) {
+    std::cout << "Popped batch of " << count << ": ids";
+    for (size_t i = 0; i < count; ++i) {
+      std::cout << " " << received[i].id;
+    }
+    std::cout << "\n";
+  }
+  std::cout << "\n";
+}
+
+// Moves items Messages from one thread to another, in batches of up to
+// Batch elements with push_n/pop_n, or one by one with push/pop when Batch
+// is 1; returns the duration in milliseconds
+template <size_t Batch>
+double measure_message_transfer(size_t items) {
+  auto queue = std::make_unique<SPSCQueue<Message, 1024>>();
+  auto start = std::chrono::high_resolution_clock::now();
+
+  std::thread producer([&queue, items]() {
+    std::array<Message, Batch> batch;
+    for (size_t sent = 0; sent < items;) {
+      size_t size = std::min(Batch, items - sent);
+      for (size_t i = 0; i < size; ++i) {
+        batch[i].id = static_cast<int>(sent + i);
+      }
+
+      for (size_t pushed = 0; pushed < size;) {
+        if constexpr (Batch == 1) {
+          pushed += queue->push(batch[0]) ? 1 : 0;
+        } else {
+          pushed += queue->push_n(batch.data() + pushed, size - pushed);
+        }
+        if (pushed < size) {
+          std::this_thread::yield();
+        }
+      }
+      sent += size;
+    }
+  });
+
+  std::thread consumer([&queue, items]() {
+    std::array<Message, Batch> batch;
+    for (size_t received = 0; received < items;) {
+      size_t count;
+      if constexpr (Batch == 1) {
+        count = queue->pop(batch[0]) ? 1 : 0;
+      } else {
+        count = queue->pop_n(batch.data(), batch.size());
+      }
+      if (count == 0) {
+        std::this_thread::yield();
+      }
+      received += count;
+    }
+  });
+
+  producer.join();
+  consumer.join();
+
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Demo 7: Bulk Transfer
+void demo_bulk_transfer() {
+  std::cout << "=== Demo 7: Bulk Transfer ===\n";
+
+  const size_t ITEMS = 10000000;
+
+  std::cout << "Transfer of " << ITEMS << " messages of " << sizeof(Message)
+            << " bytes:\n";
+  std::cout << "  push/pop          : " << measure_message_transfer<1>(ITEMS)
+            << " ms\n";
+  std::cout << "  push_n/pop_n x 16 : " << measure_message_transfer<16>(ITEMS)
+            << " ms\n";
+  std::cout << "  push_n/pop_n x 64 : " << measure_message_transfer<64>(ITEMS)
+            << " ms\n";
+  std::cout << "\n";
+}
+
+// CPU time consumed by the calling thread
+std::chrono::nanoseconds thread_cpu_time() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+// Wake-up latency of a consumer waiting on an empty queue in pop_wait, or
+// in poll() on the eventfd when Reactor is set; sorted, in us
+template <typename Wait, bool Reactor = false>
+std::vector<double> measure_wake_latency() {
+  using Clock = std::chrono::steady_clock;
+  const int MESSAGES = 500;
+
+  auto queue = std::make_unique<SPSCQueue<Clock::time_point, 64, Wait>>();
+  std::vector<double> latencies;
+  latencies.reserve(MESSAGES);
+
+  std::thread producer([&queue, MESSAGES]() {
+    for (int i = 0; i < MESSAGES; ++i) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      while (!queue->push(Clock::now())) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  Clock::time_point sent;
+  for (int i = 0; i < MESSAGES; ++i) {
+#if defined(__linux__)
+    if constexpr (Reactor) {
+      // What a Reactor does with the handle, here with a single poll()
+      while (!queue->pop(sent)) {
+        if (queue->arm_wait()) {
+          pollfd fd{queue->wait_strategy().handle(), POLLIN, 0};
+          poll(&fd, 1, -1);
+          queue->wait_strategy().reset();
+        }
+      }
+    } else
+#endif
+    {
+      queue->pop_wait(sent);
+    }
+    latencies.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - sent)
+            .count());
+  }
+
+  producer.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  return latencies;
+}
+
+// CPU time of a consumer parked 100 ms in pop_wait, in ms
+template <typename Wait>
+double measure_wait_cpu() {
+  auto queue = std::make_unique<SPSCQueue<int, 64, Wait>>();
+  double cpu_ms = 0;
+
+  std::thread consumer([&queue, &cpu_ms]() {
+    auto cpu_start = thread_cpu_time();
+    int value;
+    queue->pop_wait(value);
+    cpu_ms = std::chrono::duration<double, std::milli>(thread_cpu_time() -
+                                                       cpu_start)
+                 .count();
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  queue->push(1);
+  consumer.join();
+
+  return cpu_ms;
+}
+
+template <typename Wait, bool Reactor = false>
+void report_wait_strategy(const char* name) {
+  auto latencies = measure_wake_latency<Wait, Reactor>();
+  std::cout << "  " << std::left << std::setw(16) << name << std::right
+            << std::fixed << std::setprecision(2) << std::setw(10)
+            << latencies[latencies.size() / 2] << std::setw(10)
+            << latencies[latencies.size() * 99 / 100] << std::setw(12)
+            << measure_wait_cpu<Wait>() << "\n";
+  std::cout.unsetf(std::ios::floatfield);
+}
+
+// Demo 8: Wait Strategies
+void demo_wait_strategies() {
+  std::cout << "=== Demo 8: Wait Strategies ===\n";
+  std::cout << "Wake-up latency in us, CPU in ms while idle for 100 ms\n";
+  std::cout << "  " << std::left << std::setw(16) << "Strategy" << std::right
+            << std::setw(10) << "p50" << std::setw(10) << "p99"
+            << std::setw(12) << "Idle CPU" << "\n";
+
+  report_wait_strategy<SPSCSpinWait>("spin");
+  report_wait_strategy<SPSCSpinYieldWait<>>("spin then yield");
+  report_wait_strategy<SPSCAtomicWait>("atomic wait");
+#if defined(__linux__)
+  report_wait_strategy<SPSCEventFdWait>("eventfd");
+  report_wait_strategy<SPSCEventFdWait, true>("eventfd + poll");
+#endif
   std::cout << "\n";
 }
 
@@ -221,7 +495,10 @@ int main() {
   demo_queue_full();
   demo_producer_consumer();
   demo_performance();
+  demo_index_math();
   demo_custom_types();
+  demo_bulk_transfer();
+  demo_wait_strategies();
 
   std::cout << "All demos completed successfully!\n";
 
@@ -0,0 +1,293 @@
+// https://github.com/rigtorp/SPSCQueue
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SPSCQueue.hpp"
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+constexpr std::size_t kOperationsCount = 1000000;
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) {                                                    \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition "\n"; \
+      return false;                                                        \
+    }                                                                      \
+  } while (0)
+
+// Payload without a default constructor that tracks live instances
+struct Tracked {
+  static inline int live = 0;
+
+  explicit Tracked(int v) : value(v) { ++live; }
+  Tracked(const Tracked& other) : value(other.value) { ++live; }
+  Tracked& operator=(const Tracked&) = default;
+  ~Tracked() { --live; }
+
+  int value;
+};
+
+// Full capacity, FIFO order and wrap around for both index paths
+template <std::size_t Size, std::size_t Capacity>
+bool testCapacityAndOrder() {
+  SPSCQueue<int, Size> queue;
+  CHECK(queue.capacity() == Capacity);
+
+  for (int round = 0; round < 3; ++round) {
+    for (std::size_t i = 0; i < queue.capacity(); ++i) {
+      CHECK(queue.push(static_cast<int>(i)));
+    }
+    CHECK(!queue.push(-1));
+    CHECK(queue.size_approx() == queue.capacity());
+
+    int value = -1;
+    for (std::size_t i = 0; i < queue.capacity(); ++i) {
+      CHECK(queue.pop(value) && value == static_cast<int>(i));
+    }
+    CHECK(!queue.pop(value));
+    CHECK(queue.size_approx() == 0);
+  }
+  return true;
+}
+
+// front() peeks without consuming, pop() consumes what front() returned
+bool testFrontPop() {
+  SPSCQueue<int, 4> queue;
+  CHECK(queue.front() == nullptr);
+
+  CHECK(queue.push(1));
+  CHECK(queue.push(2));
+  CHECK(queue.front() != nullptr && *queue.front() == 1);
+  CHECK(*queue.front() == 1);
+
+  *queue.front() = 10;
+  int value = 0;
+  CHECK(queue.pop(value) && value == 10);
+
+  CHECK(*queue.front() == 2);
+  queue.pop();
+  CHECK(queue.front() == nullptr);
+  return true;
+}
+
+// Move-only and non default constructible payloads, queued payloads are
+// destroyed with the queue
+bool testEmplaceAndLifetime() {
+  {
+    SPSCQueue<std::unique_ptr<int>, 4> queue;
+    CHECK(queue.emplace(new int(1)));
+    CHECK(queue.push(std::make_unique<int>(2)));
+
+    std::unique_ptr<int> item;
+    CHECK(queue.pop(item) && *item == 1);
+    CHECK(queue.front() != nullptr && **queue.front() == 2);
+  }
+
+  {
+    SPSCQueue<Tracked, 8> queue;
+    CHECK(Tracked::live == 0);
+    for (int i = 0; i < 5; ++i) {
+      CHECK(queue.emplace(i));
+    }
+    CHECK(Tracked::live == 5);
+
+    CHECK(queue.front()->value == 0);
+    queue.pop();
+    CHECK(Tracked::live == 4);
+  }
+  CHECK(Tracked::live == 0);
+  return true;
+}
+
+// Bulk transfer split at the wrap around, partial when the queue is short
+template <typename T, std::size_t Size>
+bool testBulk(T (*make)(int)) {
+  SPSCQueue<T, Size> queue;
+  const std::size_t capacity = queue.capacity();
+
+  std::vector<T> input;
+  for (std::size_t i = 0; i < capacity + 3; ++i) {
+    input.push_back(make(static_cast<int>(i)));
+  }
+
+  // Move the indices so the next batch wraps around the buffer end
+  CHECK(queue.push_n(input.data(), 3) == 3);
+  std::vector<T> output(capacity + 3, make(-1));
+  CHECK(queue.pop_n(output.data(), 3) == 3);
+  CHECK(queue.pop_n(output.data(), 3) == 0);
+
+  CHECK(queue.push_n(input.data(), input.size()) == capacity);
+  CHECK(queue.push_n(input.data(), 1) == 0);
+  CHECK(queue.size_approx() == capacity);
+
+  CHECK(queue.pop_n(output.data(), 2) == 2);
+  CHECK(queue.pop_n(output.data() + 2, output.size()) == capacity - 2);
+  for (std::size_t i = 0; i < capacity; ++i) {
+    CHECK(output[i] == input[i]);
+  }
+  CHECK(queue.size_approx() == 0);
+  return true;
+}
+
+int makeInt(int i) { return i; }
+std::string makeString(int i) { return "message " + std::to_string(i); }
+
+// Producer and consumer threads, every value arrives once and in order
+bool testProducerConsumer() {
+  auto queue = std::make_unique<SPSCQueue<std::size_t, 1024>>();
+  std::atomic<bool> failed{false};
+
+  std::thread consumer([&queue, &failed]() {
+    for (std::size_t expected = 0; expected < kOperationsCount;) {
+      if (std::size_t* item = queue->front()) {
+        if (*item != expected) {
+          failed.store(true);
+        }
+        queue->pop();
+        ++expected;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  for (std::size_t i = 0; i < kOperationsCount; ++i) {
+    while (!queue->push(i)) {
+      std::this_thread::yield();
+    }
+  }
+
+  consumer.join();
+  CHECK(!failed.load());
+  CHECK(queue->size_approx() == 0);
+  return true;
+}
+
+// Batches of varying size across threads, every value arrives once and in
+// order
+bool testBulkProducerConsumer() {
+  auto queue = std::make_unique<SPSCQueue<std::size_t, 1024>>();
+  std::atomic<bool> failed{false};
+
+  std::thread consumer([&queue, &failed]() {
+    std::vector<std::size_t> batch(300);
+    for (std::size_t expected = 0; expected < kOperationsCount;) {
+      std::size_t count = queue->pop_n(batch.data(), batch.size());
+      for (std::size_t i = 0; i < count; ++i) {
+        if (batch[i] != expected++) {
+          failed.store(true);
+        }
+      }
+      if (count == 0) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::vector<std::size_t> batch(97);
+  for (std::size_t sent = 0; sent < kOperationsCount;) {
+    std::size_t size = std::min(batch.size(), kOperationsCount - sent);
+    std::iota(batch.begin(), batch.begin() + size, sent);
+
+    std::size_t pushed = 0;
+    while (pushed < size) {
+      pushed += queue->push_n(batch.data() + pushed, size - pushed);
+      if (pushed < size) {
+        std::this_thread::yield();
+      }
+    }
+    sent += size;
+  }
+
+  consumer.join();
+  CHECK(!failed.load());
+  return true;
+}
+
+// Consumer parked in pop_wait receives every value in order
+template <typename Wait>
+bool testPopWait() {
+  auto queue = std::make_unique<SPSCQueue<std::size_t, 64, Wait>>();
+  const std::size_t count = 20000;
+
+  std::thread producer([&queue, count]() {
+    for (std::size_t i = 0; i < count; ++i) {
+      while (!queue->push(i)) {
+        std::this_thread::yield();
+      }
+      // Let the consumer run dry and park now and then
+      if (i % 1000 == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+  });
+
+  std::size_t value = 0;
+  bool ordered = true;
+  for (std::size_t i = 0; i < count; ++i) {
+    queue->pop_wait(value);
+    ordered = ordered && value == i;
+  }
+
+  producer.join();
+  CHECK(ordered);
+  CHECK(queue->front() == nullptr);
+  return true;
+}
+
+#if defined(__linux__)
+// The eventfd is readable after a push to an armed queue, and arm_wait
+// refuses to arm a queue that has elements
+bool testEventFdHandle() {
+  SPSCQueue<int, 8, SPSCEventFdWait> queue;
+  pollfd fd{queue.wait_strategy().handle(), POLLIN, 0};
+
+  CHECK(queue.arm_wait());
+  CHECK(poll(&fd, 1, 0) == 0);
+
+  CHECK(queue.push(1));
+  CHECK(poll(&fd, 1, 1000) == 1 && (fd.revents & POLLIN) != 0);
+  queue.wait_strategy().reset();
+  CHECK(poll(&fd, 1, 0) == 0);
+
+  CHECK(!queue.arm_wait());
+  int value = 0;
+  CHECK(queue.pop(value) && value == 1);
+
+  // Not armed, so a push does not touch the eventfd
+  CHECK(queue.push(2));
+  CHECK(poll(&fd, 1, 0) == 0);
+  return true;
+}
+#endif
+
+int main() {
+  bool passed = testCapacityAndOrder<16, 16>() &&
+                testCapacityAndOrder<15, 14>() &&
+                testFrontPop() && testEmplaceAndLifetime() &&
+                testBulk<int, 16>(makeInt) && testBulk<int, 15>(makeInt) &&
+                testBulk<std::string, 8>(makeString) &&
+                testBulk<std::string, 7>(makeString) &&
+                testProducerConsumer() && testBulkProducerConsumer() &&
+                testPopWait<SPSCSpinWait>() &&
+                testPopWait<SPSCSpinYieldWait<>>() &&
+                testPopWait<SPSCAtomicWait>();
+#if defined(__linux__)
+  passed = passed && testPopWait<SPSCEventFdWait>() && testEventFdHandle();
+#endif
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,258 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "mpsc_queue.h"
+
+// https://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+// Unbounded multiple-producer, single-consumer linked queue.
+// Producer: XCHG(head) -> link the previous head to the new node
+// Consumer follows next from tail; the node it consumed from becomes the new
+// stub and the previous stub goes back to the node pool.
+//
+// push never fails for lack of space. Nodes come from a pool that grows in
+// chunks of doubling size and recycles consumed nodes, so once the pool has
+// grown to the peak queue depth no message needs an allocation.
+//
+// Node pool:
+//  - Free list is a Treiber stack of node indices tagged with a counter, so
+//    producers taking nodes while the consumer returns them are ABA-safe
+//  - Chunk k holds POOL_FIRST_CHUNK_SIZE << k nodes and is never freed before
+//    the queue, so an index always maps to the same node
+//  - One producer at a time grows the pool, the others wait for its nodes
+//    instead of each adding a chunk of doubling size
+//
+// Memory ordering:
+//  - Producers publish the node with `release` on the previous node's next
+//  - Consumer observes linked nodes with `acquire`
+//
+// Caveat: a producer preempted between XCHG and linking hides the messages
+// pushed after it; pop reports empty until that producer resumes.
+
+template <typename T>
+class MPSCLinkedQueue {
+ public:
+  MPSCLinkedQueue();
+  ~MPSCLinkedQueue();
+
+  MPSCLinkedQueue(const MPSCLinkedQueue&) = delete;
+  MPSCLinkedQueue& operator=(const MPSCLinkedQueue&) = delete;
+
+  [[nodiscard]] std::optional<T> pop() noexcept;
+
+  // Always true, the result mirrors the bounded queues; only throws
+  // std::bad_alloc when the pool cannot grow
+  [[nodiscard]] bool push(const T& msg);
+  [[nodiscard]] bool push(T&& msg);
+
+  template <typename... Args>
+  [[nodiscard]] bool emplace(Args&&... args);
+
+ private:
+  static constexpr uint32_t NO_NODE = UINT32_MAX;
+  static constexpr uint32_t POOL_FIRST_CHUNK_SIZE = 256;
+  // Keeps every node index below NO_NODE
+  static constexpr uint32_t POOL_MAX_CHUNKS = 23;
+
+  struct Node {
+    std::atomic<Node*> next{nullptr};
+    // Link in the pool free list, read by producers racing the consumer
+    std::atomic<uint32_t> nextFree{NO_NODE};
+    uint32_t index = 0;
+    alignas(T) std::byte storage[sizeof(T)];
+
+    T* data() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+  };
+
+  Node* acquireNode();
+  Node* popFreeNode() noexcept;
+  void releaseNodes(Node* first, Node* last) noexcept;
+  Node* allocateChunk();
+  Node* nodeAt(uint32_t index) const noexcept;
+
+  static uint64_t packTop(uint32_t index, uint32_t tag) noexcept {
+    return (static_cast<uint64_t>(tag) << 32) | index;
+  }
+  static uint32_t topIndex(uint64_t top) noexcept {
+    return static_cast<uint32_t>(top);
+  }
+  static uint32_t topTag(uint64_t top) noexcept {
+    return static_cast<uint32_t>(top >> 32);
+  }
+
+  // Producers only
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<Node*> head{nullptr};
+  // Consumer only
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) Node* tail = nullptr;
+
+  // Pool free list, tag in the high half, node index in the low half
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<uint64_t> freeTop{
+      packTop(NO_NODE, 0)};
+
+  // Read-mostly, written once per chunk
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<bool> growing{false};
+  std::atomic<uint32_t> chunkCount{0};
+  std::atomic<Node*> chunks[POOL_MAX_CHUNKS] = {};
+};
+
+template <typename T>
+MPSCLinkedQueue<T>::MPSCLinkedQueue() {
+  static_assert(std::atomic<Node*>::is_always_lock_free &&
+                    std::atomic<uint64_t>::is_always_lock_free,
+                "MPSCLinkedQueue requires lock-free atomics for correctness");
+  Node* stub = acquireNode();
+  head.store(stub, std::memory_order_relaxed);
+  tail = stub;
+}
+
+template <typename T>
+MPSCLinkedQueue<T>::~MPSCLinkedQueue() {
+  for (Node* node = tail->next.load(std::memory_order_acquire);
+       node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+    std::destroy_at(node->data());
+  }
+
+  uint32_t count =
+      std::min(chunkCount.load(std::memory_order_relaxed), POOL_MAX_CHUNKS);
+  for (uint32_t chunk = 0; chunk < count; ++chunk) {
+    delete[] chunks[chunk].load(std::memory_order_relaxed);
+  }
+}
+
+template <typename T>
+bool MPSCLinkedQueue<T>::push(const T& msg) {
+  return emplace(msg);
+}
+
+template <typename T>
+bool MPSCLinkedQueue<T>::push(T&& msg) {
+  return emplace(std::move(msg));
+}
+
+template <typename T>
+template <typename... Args>
+bool MPSCLinkedQueue<T>::emplace(Args&&... args) {
+  Node* node = acquireNode();
+  std::construct_at(reinterpret_cast<T*>(node->storage),
+                    std::forward<Args>(args)...);
+  node->next.store(nullptr, std::memory_order_relaxed);
+
+  Node* prev = head.exchange(node, std::memory_order_acq_rel);
+  prev->next.store(node, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+std::optional<T> MPSCLinkedQueue<T>::pop() noexcept {
+  Node* next = tail->next.load(std::memory_order_acquire);
+
+  if (next == nullptr) {
+    // queue empty, or the next producer has not linked its node yet
+    return std::nullopt;
+  }
+
+  std::optional<T> msg(std::in_place, std::move(*next->data()));
+  std::destroy_at(next->data());
+
+  // next is the new stub, the old one can be reused
+  Node* consumed = tail;
+  tail = next;
+  releaseNodes(consumed, consumed);
+
+  return msg;
+}
+
+template <typename T>
+typename MPSCLinkedQueue<T>::Node* MPSCLinkedQueue<T>::acquireNode() {
+  while (true) {
+    if (Node* node = popFreeNode()) {
+      return node;
+    }
+
+    if (!growing.exchange(true, std::memory_order_acquire)) {
+      // Another producer may have grown the pool since the check above
+      Node* node = popFreeNode();
+      try {
+        if (node == nullptr) {
+          node = allocateChunk();
+        }
+      } catch (...) {
+        growing.store(false, std::memory_order_release);
+        throw;
+      }
+      growing.store(false, std::memory_order_release);
+      return node;
+    }
+
+    std::this_thread::yield();
+  }
+}
+
+template <typename T>
+typename MPSCLinkedQueue<T>::Node* MPSCLinkedQueue<T>::popFreeNode() noexcept {
+  uint64_t top = freeTop.load(std::memory_order_acquire);
+
+  while (topIndex(top) != NO_NODE) {
+    Node* node = nodeAt(topIndex(top));
+    uint32_t next = node->nextFree.load(std::memory_order_relaxed);
+
+    // The tag changes on every update, so a node taken and returned in
+    // between fails the CAS even though the index matches
+    if (freeTop.compare_exchange_weak(top, packTop(next, topTag(top) + 1),
+                                      std::memory_order_acquire,
+                                      std::memory_order_acquire)) {
+      return node;
+    }
+  }
+
+  return nullptr;
+}
+
+template <typename T>
+void MPSCLinkedQueue<T>::releaseNodes(Node* first, Node* last) noexcept {
+  uint64_t top = freeTop.load(std::memory_order_relaxed);
+
+  do {
+    last->nextFree.store(topIndex(top), std::memory_order_relaxed);
+  } while (!freeTop.compare_exchange_weak(
+      top, packTop(first->index, topTag(top) + 1), std::memory_order_release,
+      std::memory_order_relaxed));
+}
+
+template <typename T>
+typename MPSCLinkedQueue<T>::Node* MPSCLinkedQueue<T>::allocateChunk() {
+  uint32_t chunk = chunkCount.fetch_add(1, std::memory_order_relaxed);
+  if (chunk >= POOL_MAX_CHUNKS) {
+    throw std::bad_alloc();
+  }
+
+  const uint32_t size = POOL_FIRST_CHUNK_SIZE << chunk;
+  const uint32_t firstIndex = POOL_FIRST_CHUNK_SIZE * ((1u << chunk) - 1);
+
+  Node* nodes = new Node[size];
+  for (uint32_t i = 0; i < size; ++i) {
+    nodes[i].index = firstIndex + i;
+    nodes[i].nextFree.store(firstIndex + i + 1, std::memory_order_relaxed);
+  }
+  chunks[chunk].store(nodes, std::memory_order_release);
+
+  // Keep the first node, hand the rest to the pool in one CAS
+  releaseNodes(&nodes[1], &nodes[size - 1]);
+  return &nodes[0];
+}
+
+template <typename T>
+typename MPSCLinkedQueue<T>::Node* MPSCLinkedQueue<T>::nodeAt(
+    uint32_t index) const noexcept {
+  const uint32_t chunk = std::bit_width(index / POOL_FIRST_CHUNK_SIZE + 1) - 1;
+  const uint32_t firstIndex = POOL_FIRST_CHUNK_SIZE * ((1u << chunk) - 1);
+  return chunks[chunk].load(std::memory_order_acquire) + (index - firstIndex);
+}
@@ -1,7 +1,16 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <optional>
+#include <semaphore>
+#include <span>
+#include <stdexcept>
 #include <thread>
+#include <utility>
+
+#include "mpsc_queue_stats.h"
 
 // https://github.com/bowtoyourlord/MPSCQueue
 // Multiple-producer, single-consumer ring-buffer queue.
@@ -13,83 +22,328 @@
 // Memory ordering:
 //  - Producers publish writes with `release` on commitWriteIndex
 //  - Consumer observes committed writes with `acquire`
+//  - Consumer frees slots with `release` on readIndex, producers observe
+//    freed slots with `acquire` before overwriting them
 //
 // Invariant: commitWriteIndex >= reserveWriteIndex >= readIndex
+//
+// Layout:
+//  - Capacity is chosen per instance and must be a power of 2
+//  - Each index sits on its own cache line, so consumer stores to readIndex
+//    and producer CASes on the write indices do not false-share
+//  - Slots are obtained from Allocator, e.g. one backed by huge pages
+//
+// Storage:
+//  - Slots are uninitialized memory, T is constructed in place on push and
+//    moved out and destroyed on pop, so T needs no default constructor
+//  - Messages still queued at destruction are destroyed with the queue
+//
+// Batching:
+//  - try_push_n reserves a contiguous range with one CAS and commits it with
+//    one CAS, so a burst costs the same atomic traffic as a single push
+//  - pop_bulk drains every committed slot and advances readIndex once
+//
+// Blocking consumer (opt-in):
+//  - pop_wait/pop_wait_for park the consumer on a futex-backed semaphore
+//    instead of spinning on pop
+//  - The consumer raises consumerWaiting before parking and re-checks
+//    commitWriteIndex; producers check the flag after their commit and only
+//    the one that clears it posts the semaphore, so producers pay a single
+//    load when nobody waits
+//  - Both sides use seq_cst on the flag and commitWriteIndex, so either the
+//    consumer sees the commit or the producer sees the flag
+//
+// Instrumentation (opt-in):
+//  - Stats receives a hook for every reserve retry, commit wait spin, full
+//    rejection, empty poll, enqueue and dequeue, see mpsc_queue_stats.h
+//  - The default MPSCNoStats hooks are empty, so nothing is compiled in
 
-const size_t MPSC_QUEUE_CAPACITY = 1024;  // must be power of 2
+const size_t MPSC_QUEUE_CAPACITY = 1024;  // default, must be power of 2
 
-template <typename T>
+// std::hardware_destructive_interference_size, fixed so that the queue
+// layout does not change with compiler version or -mtune
+const size_t MPSC_QUEUE_CACHE_LINE_SIZE = 64;
+
+template <typename T, typename Allocator = std::allocator<T>,
+          typename Stats = MPSCNoStats>
 class MPSCQueue {
  public:
-  MPSCQueue();
+  explicit MPSCQueue(size_t capacity = MPSC_QUEUE_CAPACITY,
+                     const Allocator& alloc = Allocator());
   ~MPSCQueue();
 
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
   [[nodiscard]] std::optional<T> pop() noexcept;
+  // Blocks until a message is committed
+  [[nodiscard]] std::optional<T> pop_wait();
+  // Blocks until a message is committed or timeout expires
+  template <typename Rep, typename Period>
+  [[nodiscard]] std::optional<T> pop_wait_for(
+      const std::chrono::duration<Rep, Period>& timeout);
+
   [[nodiscard]] bool push(const T& msg) noexcept;
+  [[nodiscard]] bool push(T&& msg) noexcept;
+
+  template <typename... Args>
+  [[nodiscard]] bool emplace(Args&&... args) noexcept;
+
+  // Pushes all of msgs or nothing
+  [[nodiscard]] bool try_push_n(std::span<const T> msgs) noexcept;
+  // Moves up to max committed messages into out, returns how many
+  template <typename OutputIt>
+  size_t pop_bulk(OutputIt out, size_t max);
+
+  [[nodiscard]] size_t capacity() const noexcept { return slotCount; }
+
+  [[nodiscard]] const Stats& stats() const noexcept { return instrumentation; }
 
  private:
-  static constexpr size_t capacity = MPSC_QUEUE_CAPACITY;
-  static constexpr size_t maxIndexMask = capacity - 1;
+  using AllocatorTraits = std::allocator_traits<Allocator>;
+
+  // Reserves count slots, returns false when they do not fit
+  bool reserve(size_t count, size_t& first) noexcept;
+  // Publishes [first, first + count) once all earlier reservations are
+  // committed
+  void commit(size_t first, size_t count) noexcept;
 
-  std::atomic<size_t> readIndex{0};
-  std::atomic<size_t> commitWriteIndex{0};
-  std::atomic<size_t> reserveWriteIndex{0};
+  // Announces the consumer is about to park, returns false when a message
+  // was committed meanwhile and parking must be skipped
+  bool prepareWait();
+  // Withdraws the announcement after a skipped or timed out park
+  void cancelWait();
 
+  // Read-only after construction
+  [[no_unique_address]] Allocator allocator;
+  const size_t slotCount;
+  const size_t maxIndexMask;
   T* buf = nullptr;
+
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> readIndex{0};
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> commitWriteIndex{0};
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> reserveWriteIndex{0};
+
+  // Written by the consumer only when parking, read by producers per commit
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<bool> consumerWaiting{false};
+  std::binary_semaphore wakeup{0};
+
+  [[no_unique_address]] Stats instrumentation;
 };
 
-template <typename T>
-MPSCQueue<T>::MPSCQueue() {
-  static_assert((capacity > 0 && ((capacity & (capacity - 1)) == 0)),
-                "MPSCQueue algorithms are optimised for and intended to work "
-                "only with capacity of power of 2");
+template <typename T, typename Allocator, typename Stats>
+MPSCQueue<T, Allocator, Stats>::MPSCQueue(size_t capacity,
+                                          const Allocator& alloc)
+    : allocator(alloc), slotCount(capacity), maxIndexMask(capacity - 1) {
   static_assert(std::atomic<size_t>::is_always_lock_free,
                 "MPSCQueue requires lock-free atomics for correctness");
-  buf = new T[capacity];
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    throw std::invalid_argument(
+        "MPSCQueue algorithms are optimised for and intended to work only "
+        "with capacity of power of 2");
+  }
+
+  instrumentation.init(slotCount);
+  buf = AllocatorTraits::allocate(allocator, slotCount);
 }
 
-template <typename T>
-MPSCQueue<T>::~MPSCQueue() {
-  delete[] buf;
+template <typename T, typename Allocator, typename Stats>
+MPSCQueue<T, Allocator, Stats>::~MPSCQueue() {
+  size_t r = readIndex.load(std::memory_order_relaxed);
+  size_t cw = commitWriteIndex.load(std::memory_order_acquire);
+
+  for (; r != cw; ++r) {
+    std::destroy_at(buf + (r & maxIndexMask));
+  }
+  AllocatorTraits::deallocate(allocator, buf, slotCount);
 }
 
-template <typename T>
-bool MPSCQueue<T>::push(const T& msg) noexcept {
+template <typename T, typename Allocator, typename Stats>
+bool MPSCQueue<T, Allocator, Stats>::reserve(size_t count,
+                                             size_t& first) noexcept {
+  if (count > slotCount) {
+    return false;
+  }
+
+  size_t rw = reserveWriteIndex.load(std::memory_order_relaxed);
   while (true) {
-    size_t rw = reserveWriteIndex.load(std::memory_order_relaxed);
-    size_t r = readIndex.load(std::memory_order_relaxed);
+    size_t r = readIndex.load(std::memory_order_acquire);
 
-    if (rw - r == capacity) {
-      // Buffer is full, writer has lapped the reader by full capacity
+    if (slotCount - (rw - r) < count) {
+      // Buffer is full, writer would lap the reader by full capacity
+      instrumentation.onFull();
       return false;
     }
 
-    if (reserveWriteIndex.compare_exchange_weak(rw, rw + 1,
+    if (reserveWriteIndex.compare_exchange_weak(rw, rw + count,
                                                 std::memory_order_relaxed)) {
-      buf[rw & maxIndexMask] = msg;
-
-      while (!commitWriteIndex.compare_exchange_weak(
-          rw, rw + 1, std::memory_order_release, std::memory_order_relaxed)) {
-        std::this_thread::yield();
-      }
+      first = rw;
       return true;
     }
+    instrumentation.onReserveRetry();
+  }
+}
+
+template <typename T, typename Allocator, typename Stats>
+void MPSCQueue<T, Allocator, Stats>::commit(size_t first,
+                                            size_t count) noexcept {
+  // compare_exchange_weak overwrites expected on failure, so it must be reset
+  // on every attempt, otherwise another producer's slot would be committed
+  size_t expected = first;
+  while (!commitWriteIndex.compare_exchange_weak(expected, first + count,
+                                                 std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed)) {
+    expected = first;
+    instrumentation.onCommitSpin();
+    std::this_thread::yield();
+  }
+
+  if (consumerWaiting.load(std::memory_order_seq_cst) &&
+      consumerWaiting.exchange(false, std::memory_order_acq_rel)) {
+    wakeup.release();
   }
 }
 
-template <typename T>
-std::optional<T> MPSCQueue<T>::pop() noexcept {
+template <typename T, typename Allocator, typename Stats>
+bool MPSCQueue<T, Allocator, Stats>::prepareWait() {
+  consumerWaiting.store(true, std::memory_order_seq_cst);
+
+  if (commitWriteIndex.load(std::memory_order_seq_cst) !=
+      readIndex.load(std::memory_order_relaxed)) {
+    cancelWait();
+    return false;
+  }
+  return true;
+}
+
+template <typename T, typename Allocator, typename Stats>
+void MPSCQueue<T, Allocator, Stats>::cancelWait() {
+  if (!consumerWaiting.exchange(false, std::memory_order_acq_rel)) {
+    // A producer already cleared the flag and is posting the semaphore,
+    // take the permit so the next park does not return spuriously
+    wakeup.acquire();
+  }
+}
+
+template <typename T, typename Allocator, typename Stats>
+bool MPSCQueue<T, Allocator, Stats>::push(const T& msg) noexcept {
+  return emplace(msg);
+}
+
+template <typename T, typename Allocator, typename Stats>
+bool MPSCQueue<T, Allocator, Stats>::push(T&& msg) noexcept {
+  return emplace(std::move(msg));
+}
+
+template <typename T, typename Allocator, typename Stats>
+template <typename... Args>
+bool MPSCQueue<T, Allocator, Stats>::emplace(Args&&... args) noexcept {
+  size_t rw = 0;
+  if (!reserve(1, rw)) {
+    return false;
+  }
+
+  std::construct_at(buf + (rw & maxIndexMask), std::forward<Args>(args)...);
+  instrumentation.onEnqueue(rw);
+
+  commit(rw, 1);
+  return true;
+}
+
+template <typename T, typename Allocator, typename Stats>
+bool MPSCQueue<T, Allocator, Stats>::try_push_n(
+    std::span<const T> msgs) noexcept {
+  if (msgs.empty()) {
+    return true;
+  }
+
+  size_t rw = 0;
+  if (!reserve(msgs.size(), rw)) {
+    return false;
+  }
+
+  for (const T& msg : msgs) {
+    instrumentation.onEnqueue(rw);
+    std::construct_at(buf + (rw++ & maxIndexMask), msg);
+  }
+
+  commit(rw - msgs.size(), msgs.size());
+  return true;
+}
+
+template <typename T, typename Allocator, typename Stats>
+std::optional<T> MPSCQueue<T, Allocator, Stats>::pop() noexcept {
   size_t r = readIndex.load(std::memory_order_relaxed);
   size_t cw = commitWriteIndex.load(std::memory_order_acquire);
 
   if (cw == r) {
     // buffer empty
+    instrumentation.onEmpty();
     return std::nullopt;
   }
 
-  auto msg = buf[r & maxIndexMask];
+  instrumentation.onDequeue(r);
+
+  T* slot = buf + (r & maxIndexMask);
+  std::optional<T> msg(std::in_place, std::move(*slot));
+  std::destroy_at(slot);
+
+  readIndex.store(r + 1, std::memory_order_release);
+
+  return msg;
+}
+
+template <typename T, typename Allocator, typename Stats>
+std::optional<T> MPSCQueue<T, Allocator, Stats>::pop_wait() {
+  while (true) {
+    if (auto msg = pop()) {
+      return msg;
+    }
+
+    if (prepareWait()) {
+      wakeup.acquire();
+    }
+  }
+}
+
+template <typename T, typename Allocator, typename Stats>
+template <typename Rep, typename Period>
+std::optional<T> MPSCQueue<T, Allocator, Stats>::pop_wait_for(
+    const std::chrono::duration<Rep, Period>& timeout) {
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  while (true) {
+    if (auto msg = pop()) {
+      return msg;
+    }
+
+    if (prepareWait() && !wakeup.try_acquire_until(deadline)) {
+      cancelWait();
+      return pop();
+    }
+  }
+}
+
+template <typename T, typename Allocator, typename Stats>
+template <typename OutputIt>
+size_t MPSCQueue<T, Allocator, Stats>::pop_bulk(OutputIt out, size_t max) {
+  size_t r = readIndex.load(std::memory_order_relaxed);
+  size_t cw = commitWriteIndex.load(std::memory_order_acquire);
+
+  size_t count = std::min(cw - r, max);
+  if (count == 0) {
+    instrumentation.onEmpty();
+    return 0;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    instrumentation.onDequeue(r + i);
+    T* slot = buf + ((r + i) & maxIndexMask);
+    *out++ = std::move(*slot);
+    std::destroy_at(slot);
+  }
 
-  readIndex.store(r + 1, std::memory_order_relaxed);
+  readIndex.store(r + count, std::memory_order_release);
 
-  return std::make_optional(msg);
+  return count;
 }
@@ -0,0 +1,242 @@
+// Google Benchmark suite for the MPSC queue family.
+// Every benchmark moves a fixed number of messages from N producer threads
+// to the benchmark thread acting as consumer.
+// Arguments: producers, capacity (bounded queues only), burst (messages
+// pushed before a producer pauses, 0 for a continuous stream).
+// Counters: items_per_second, enqueue-to-dequeue latency percentiles and
+// cache misses per message where perf_event is available.
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "mpsc_linked_queue.h"
+#include "mpsc_queue.h"
+#include "mpsc_queue_stats.h"
+#include "mpsc_sequenced_queue.h"
+#include "sharded_mpsc_queue.h"
+
+namespace {
+
+constexpr int TOTAL_ITEMS = 1 << 16;
+constexpr auto BURST_PAUSE = std::chrono::microseconds(10);
+
+// Message of Size bytes, the first 8 carry the enqueue time
+template <size_t Size>
+struct Payload {
+  int64_t enqueued = 0;
+  std::byte padding[Size - sizeof(int64_t)] = {};
+};
+
+template <>
+struct Payload<sizeof(int64_t)> {
+  int64_t enqueued = 0;
+};
+
+template <typename T>
+using ShardedQueue = ShardedMPSC<T>;
+
+int64_t now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Counts hardware cache misses of this thread and of threads it starts
+// while the counter is open. Unavailable without perf_event access.
+class CacheMissCounter {
+ public:
+  CacheMissCounter() {
+#if defined(__linux__)
+    perf_event_attr attr{};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  ~CacheMissCounter() {
+#if defined(__linux__)
+    if (fd >= 0) {
+      close(fd);
+    }
+#endif
+  }
+
+  CacheMissCounter(const CacheMissCounter&) = delete;
+  CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+  [[nodiscard]] bool available() const noexcept { return fd >= 0; }
+
+  // Misses so far, including those of joined child threads
+  [[nodiscard]] uint64_t read() const noexcept {
+    uint64_t value = 0;
+#if defined(__linux__)
+    if (fd >= 0 && ::read(fd, &value, sizeof(value)) != sizeof(value)) {
+      value = 0;
+    }
+#endif
+    return value;
+  }
+
+ private:
+  int fd = -1;
+};
+
+// Bounded queues take the capacity, unbounded and sharded ones ignore it
+template <typename Queue>
+std::unique_ptr<Queue> make_queue(size_t capacity) {
+  if constexpr (std::is_constructible_v<Queue, size_t>) {
+    return std::make_unique<Queue>(capacity);
+  } else {
+    return std::make_unique<Queue>();
+  }
+}
+
+template <typename Queue, typename T>
+void produce(Queue& queue, int items, int burst) {
+  // Sharded queues hand out a lane per producer
+  auto push = [&queue]() {
+    if constexpr (requires { queue.registerProducer(); }) {
+      return [producer = queue.registerProducer()](const T& msg) mutable {
+        return producer.push(msg);
+      };
+    } else {
+      return [&queue](const T& msg) { return queue.push(msg); };
+    }
+  }();
+
+  T msg{};
+  for (int i = 0; i < items; ++i) {
+    msg.enqueued = now_ns();
+    while (!push(msg)) {
+      std::this_thread::yield();
+    }
+    if (burst > 0 && (i + 1) % burst == 0) {
+      std::this_thread::sleep_for(BURST_PAUSE);
+    }
+  }
+}
+
+template <template <typename...> class QueueT, size_t PayloadSize>
+void BM_Transfer(benchmark::State& state) {
+  using T = Payload<PayloadSize>;
+  using Queue = QueueT<T>;
+
+  const int producers = static_cast<int>(state.range(0));
+  const auto capacity = static_cast<size_t>(state.range(1));
+  const int burst = static_cast<int>(state.range(2));
+  const int items_per_producer = TOTAL_ITEMS / producers;
+  const int total = items_per_producer * producers;
+
+  MPSCLatencyHistogram latency;
+  CacheMissCounter cache_misses;
+  const uint64_t misses_before = cache_misses.read();
+
+  for (auto _ : state) {
+    auto queue = make_queue<Queue>(capacity);
+
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+    for (int p = 0; p < producers; ++p) {
+      threads.emplace_back(
+          [&]() { produce<Queue, T>(*queue, items_per_producer, burst); });
+    }
+
+    for (int consumed = 0; consumed < total;) {
+      if (auto msg = queue->pop()) {
+        const int64_t elapsed = now_ns() - msg->enqueued;
+        latency.record(elapsed > 0 ? static_cast<uint64_t>(elapsed) : 0);
+        consumed++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  const auto items = static_cast<double>(state.iterations()) * total;
+  state.SetItemsProcessed(static_cast<int64_t>(items));
+  state.counters["p50_ns"] = static_cast<double>(latency.percentile(50));
+  state.counters["p99_ns"] = static_cast<double>(latency.percentile(99));
+  state.counters["p99.9_ns"] = static_cast<double>(latency.percentile(99.9));
+  if (cache_misses.available()) {
+    state.counters["misses/item"] =
+        static_cast<double>(cache_misses.read() - misses_before) / items;
+  }
+}
+
+// Producer count, capacity and burstiness sweeps for one payload size. Only
+// bounded queues get the capacity sweep, the others would repeat one
+// configuration under different labels.
+template <typename Queue>
+void full_sweep(benchmark::internal::Benchmark* b) {
+  for (int producers : {1, 2, 4, 8, 16, 32}) {
+    b->Args({producers, 1024, 0});
+  }
+  if constexpr (std::is_constructible_v<Queue, size_t>) {
+    for (int capacity : {256, 4096, 16384}) {
+      b->Args({4, capacity, 0});
+    }
+  }
+  for (int burst : {16, 256}) {
+    b->Args({4, 1024, burst});
+  }
+}
+
+// Single point used to compare payload sizes
+void payload_point(benchmark::internal::Benchmark* b) {
+  b->Args({4, 1024, 0});
+}
+
+}  // namespace
+
+#define MPSC_QUEUE_BENCHMARKS(QueueT)                                    \
+  BENCHMARK_TEMPLATE(BM_Transfer, QueueT, 8)                             \
+      ->ArgNames({"producers", "capacity", "burst"})                     \
+      ->Apply(full_sweep<QueueT<Payload<8>>>)                            \
+      ->UseRealTime()                                                    \
+      ->Unit(benchmark::kMillisecond);                                   \
+  BENCHMARK_TEMPLATE(BM_Transfer, QueueT, 64)                            \
+      ->ArgNames({"producers", "capacity", "burst"})                     \
+      ->Apply(payload_point)                                             \
+      ->UseRealTime()                                                    \
+      ->Unit(benchmark::kMillisecond);                                   \
+  BENCHMARK_TEMPLATE(BM_Transfer, QueueT, 256)                           \
+      ->ArgNames({"producers", "capacity", "burst"})                     \
+      ->Apply(payload_point)                                             \
+      ->UseRealTime()                                                    \
+      ->Unit(benchmark::kMillisecond)
+
+MPSC_QUEUE_BENCHMARKS(MPSCQueue);
+MPSC_QUEUE_BENCHMARKS(MPSCSequencedQueue);
+MPSC_QUEUE_BENCHMARKS(MPSCLinkedQueue);
+MPSC_QUEUE_BENCHMARKS(ShardedQueue);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,174 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+// Instrumentation policies for MPSCQueue.
+//
+// MPSCNoStats is the default: every hook is an empty inline function and
+// the member takes no space, so the instrumented code compiles out.
+//
+// MPSCQueueStats counts why producers and the consumer did not make
+// progress and keeps a log-linear (HDR-style) histogram of the time a
+// message spent in the queue:
+//  - reserveRetries : reserve CAS lost to another producer
+//  - commitSpins    : commit CAS waiting for an earlier producer
+//  - fullRejections : push refused because the buffer was full
+//  - emptyPolls     : pop found nothing committed
+// Producer counters are shared atomics, so enabling stats adds contention.
+//
+// Latency stamps are written by the producer before its commit and read by
+// the consumer after observing it, so the queue's own release/acquire
+// ordering covers them.
+
+struct MPSCNoStats {
+  void init(size_t) {}
+
+  void onReserveRetry() noexcept {}
+  void onCommitSpin() noexcept {}
+  void onFull() noexcept {}
+  void onEmpty() noexcept {}
+  void onEnqueue(size_t) noexcept {}
+  void onDequeue(size_t) noexcept {}
+};
+
+// Histogram with 16 linear sub-buckets per power of 2, so any recorded
+// value is off by at most 1/16 of its magnitude
+struct MPSCLatencyHistogram {
+  static constexpr unsigned SUB_BUCKET_BITS = 4;
+  static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+  static constexpr size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  static size_t bucketOf(uint64_t value) noexcept {
+    if (value < 2 * SUB_BUCKETS) {
+      return static_cast<size_t>(value);
+    }
+    const unsigned shift = std::bit_width(value) - SUB_BUCKET_BITS - 1;
+    return (shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+  }
+
+  static uint64_t lowerBoundOf(size_t bucket) noexcept {
+    if (bucket < 2 * SUB_BUCKETS) {
+      return bucket;
+    }
+    const unsigned shift = bucket / SUB_BUCKETS - 1;
+    return (bucket % SUB_BUCKETS + SUB_BUCKETS) << shift;
+  }
+
+  std::array<uint64_t, BUCKETS> counts{};
+  uint64_t total = 0;
+  uint64_t max = 0;
+
+  // Single-threaded recording, e.g. by a benchmark consumer
+  void record(uint64_t value) noexcept {
+    ++counts[bucketOf(value)];
+    ++total;
+    max = std::max(max, value);
+  }
+
+  // Smallest recorded value at or above the given percentile, 0 when empty
+  [[nodiscard]] uint64_t percentile(double p) const noexcept {
+    if (total == 0) {
+      return 0;
+    }
+    auto rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total));
+    rank = rank == 0 ? 1 : rank;
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+      seen += counts[bucket];
+      if (seen >= rank) {
+        return lowerBoundOf(bucket);
+      }
+    }
+    return max;
+  }
+};
+
+struct MPSCQueueStatsSnapshot {
+  uint64_t reserveRetries = 0;
+  uint64_t commitSpins = 0;
+  uint64_t fullRejections = 0;
+  uint64_t emptyPolls = 0;
+  // Enqueue to dequeue latency in nanoseconds
+  MPSCLatencyHistogram latency;
+};
+
+class MPSCQueueStats {
+ public:
+  void init(size_t capacity) {
+    indexMask = capacity - 1;
+    enqueueTimes = std::make_unique<int64_t[]>(capacity);
+  }
+
+  void onReserveRetry() noexcept {
+    reserveRetries.fetch_add(1, std::memory_order_relaxed);
+  }
+  void onCommitSpin() noexcept {
+    commitSpins.fetch_add(1, std::memory_order_relaxed);
+  }
+  void onFull() noexcept {
+    fullRejections.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Consumer only, a plain increment is enough
+  void onEmpty() noexcept {
+    emptyPolls.store(emptyPolls.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+  }
+
+  void onEnqueue(size_t index) noexcept {
+    enqueueTimes[index & indexMask] = now();
+  }
+
+  // Consumer only
+  void onDequeue(size_t index) noexcept {
+    const int64_t elapsed = now() - enqueueTimes[index & indexMask];
+    const uint64_t value = elapsed > 0 ? static_cast<uint64_t>(elapsed) : 0;
+
+    auto& bucket = latency[MPSCLatencyHistogram::bucketOf(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+    if (value > latencyMax.load(std::memory_order_relaxed)) {
+      latencyMax.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  // Safe to call from any thread, counters are read one at a time so the
+  // snapshot is not an atomic cut while the queue is in use
+  [[nodiscard]] MPSCQueueStatsSnapshot snapshot() const noexcept {
+    MPSCQueueStatsSnapshot result;
+    result.reserveRetries = reserveRetries.load(std::memory_order_relaxed);
+    result.commitSpins = commitSpins.load(std::memory_order_relaxed);
+    result.fullRejections = fullRejections.load(std::memory_order_relaxed);
+    result.emptyPolls = emptyPolls.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < MPSCLatencyHistogram::BUCKETS; ++i) {
+      result.latency.counts[i] = latency[i].load(std::memory_order_relaxed);
+      result.latency.total += result.latency.counts[i];
+    }
+    result.latency.max = latencyMax.load(std::memory_order_relaxed);
+    return result;
+  }
+
+ private:
+  static int64_t now() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  size_t indexMask = 0;
+  std::unique_ptr<int64_t[]> enqueueTimes;
+
+  std::atomic<uint64_t> reserveRetries{0};
+  std::atomic<uint64_t> commitSpins{0};
+  std::atomic<uint64_t> fullRejections{0};
+  std::atomic<uint64_t> emptyPolls{0};
+  std::array<std::atomic<uint64_t>, MPSCLatencyHistogram::BUCKETS> latency{};
+  std::atomic<uint64_t> latencyMax{0};
+};
@@ -1,14 +1,78 @@
+#include "mpsc_linked_queue.h"
 #include "mpsc_queue.h"
+#include "mpsc_sequenced_queue.h"
+#include "sharded_mpsc_queue.h"
+
+#if defined(__linux__)
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mpsc_shared_queue.h"
+#endif
 
 #include <algorithm>
 #include <chrono>
+#include <ctime>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <numeric>
 #include <random>
 #include <set>
+#include <span>
+#include <string>
 #include <thread>
+#include <type_traits>
 #include <vector>
 
+// Counts allocations so tests can check the queue uses the given allocator
+struct AllocationCounter {
+  static inline std::atomic<size_t> allocations{0};
+  static inline std::atomic<size_t> deallocations{0};
+};
+
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  CountingAllocator() = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) noexcept {}
+
+  T* allocate(size_t n) {
+    AllocationCounter::allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::allocator<T>{}.allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) noexcept {
+    AllocationCounter::deallocations.fetch_add(1, std::memory_order_relaxed);
+    std::allocator<T>{}.deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>&) const noexcept {
+    return true;
+  }
+};
+
+// Payload without a default constructor that tracks live instances
+struct TrackedPayload {
+  static inline int live = 0;
+
+  explicit TrackedPayload(int v) : value(v) { ++live; }
+  TrackedPayload(const TrackedPayload& other) : value(other.value) { ++live; }
+  TrackedPayload(TrackedPayload&& other) noexcept : value(other.value) {
+    ++live;
+  }
+  TrackedPayload& operator=(const TrackedPayload&) = default;
+  TrackedPayload& operator=(TrackedPayload&&) noexcept = default;
+  ~TrackedPayload() { --live; }
+
+  int value;
+};
+
 // Simple test framework
 int total_tests = 0;
 int passed_tests = 0;
@@ -23,23 +87,43 @@ int failed_tests = 0;
     }                                                                \
   } while (0)
 
-#define RUN_TEST(test_func)                                               \
-  do {                                                                    \
-    total_tests++;                                                        \
-    std::cout << "\n[TEST " << total_tests << "] " << #test_func << "..." \
-              << std::endl;                                               \
-    if (test_func()) {                                                    \
-      passed_tests++;                                                     \
-      std::cout << "  ✓ PASSED" << std::endl;                             \
-    } else {                                                              \
-      failed_tests++;                                                     \
-      std::cout << "  ✗ FAILED" << std::endl;                             \
-    }                                                                     \
+#define RUN_TEST(...)                                                       \
+  do {                                                                      \
+    total_tests++;                                                          \
+    std::cout << "\n[TEST " << total_tests << "] " << #__VA_ARGS__ << "..." \
+              << std::endl;                                                 \
+    if (__VA_ARGS__()) {                                                    \
+      passed_tests++;                                                       \
+      std::cout << "  ✓ PASSED" << std::endl;                               \
+    } else {                                                                \
+      failed_tests++;                                                       \
+      std::cout << "  ✗ FAILED" << std::endl;                               \
+    }                                                                       \
   } while (0)
 
+using InstrumentedMPSCQueue =
+    MPSCQueue<int, std::allocator<int>, MPSCQueueStats>;
+
+// Prints the contention counters and latency of an instrumented queue
+template <typename Queue>
+void report_stats(const Queue& queue) {
+  if constexpr (requires { queue.stats().snapshot(); }) {
+    auto stats = queue.stats().snapshot();
+    std::cout << "  Reserve retries: " << stats.reserveRetries
+              << ", commit spins: " << stats.commitSpins
+              << ", full rejections: " << stats.fullRejections
+              << ", empty polls: " << stats.emptyPolls << std::endl;
+    std::cout << "  Latency ns p50: " << stats.latency.percentile(50)
+              << ", p99: " << stats.latency.percentile(99)
+              << ", p99.9: " << stats.latency.percentile(99.9)
+              << ", max: " << stats.latency.max << std::endl;
+  }
+}
+
 // Basic single-threaded sanity test
+template <typename Queue>
 bool test_single_threaded_basic() {
-  MPSCQueue<int> queue;
+  Queue queue;
 
   TEST_ASSERT(queue.push(1), "Failed to push 1");
   TEST_ASSERT(queue.push(2), "Failed to push 2");
@@ -60,8 +144,9 @@ bool test_single_threaded_basic() {
 }
 
 // Test that queue correctly reports full when at capacity
+template <typename Queue>
 bool test_capacity_limit() {
-  MPSCQueue<int> queue;
+  Queue queue;
 
   for (size_t i = 0; i < MPSC_QUEUE_CAPACITY; ++i) {
     if (!queue.push(i)) {
@@ -76,8 +161,9 @@ bool test_capacity_limit() {
 }
 
 // Test multiple producers, single consumer - correctness
+template <typename Queue>
 bool test_multiple_producers_single_consumer() {
-  MPSCQueue<int> queue;
+  Queue queue;
   const int NUM_PRODUCERS = 4;
   const int ITEMS_PER_PRODUCER = 1000;
   const int TOTAL_ITEMS = NUM_PRODUCERS * ITEMS_PER_PRODUCER;
@@ -137,8 +223,9 @@ bool test_multiple_producers_single_consumer() {
 }
 
 // Test high contention scenario
+template <typename Queue>
 bool test_high_contention_stress() {
-  MPSCQueue<int> queue;
+  Queue queue;
   const int NUM_PRODUCERS = 8;
   const int ITEMS_PER_PRODUCER = 5000;
   const int TOTAL_ITEMS = NUM_PRODUCERS * ITEMS_PER_PRODUCER;
@@ -200,13 +287,15 @@ bool test_high_contention_stress() {
 
   std::cout << "  Consumed " << received.size() << " items, "
             << push_failures.load() << " push failures" << std::endl;
+  report_stats(queue);
 
   return true;
 }
 
 // Test FIFO ordering per producer
+template <typename Queue>
 bool test_fifo_ordering_per_producer() {
-  MPSCQueue<int> queue;
+  Queue queue;
   const int NUM_PRODUCERS = 4;
   const int ITEMS_PER_PRODUCER = 500;
 
@@ -272,8 +361,9 @@ bool test_fifo_ordering_per_producer() {
 }
 
 // Test queue behavior when full
+template <typename Queue>
 bool test_full_queue_behavior() {
-  MPSCQueue<int> queue;
+  Queue queue;
   const int NUM_PRODUCERS = 4;
   std::atomic<int> successful_pushes{0};
   std::atomic<bool> start{false};
@@ -315,8 +405,9 @@ bool test_full_queue_behavior() {
 }
 
 // Test alternating push/pop pattern
+template <typename Queue>
 bool test_alternating_push_pop() {
-  MPSCQueue<int> queue;
+  Queue queue;
   const int NUM_PRODUCERS = 3;
   const int OPERATIONS = 1000;
 
@@ -360,8 +451,9 @@ bool test_alternating_push_pop() {
 }
 
 // Test with variable-rate producers
+template <typename Queue>
 bool test_variable_rate_producers() {
-  MPSCQueue<int> queue;
+  Queue queue;
   const int NUM_PRODUCERS = 4;
   const int ITEMS_PER_PRODUCER = 500;
 
@@ -410,23 +502,1017 @@ bool test_variable_rate_producers() {
   }
 
   TEST_ASSERT(received.size() == expected, "Not all items received");
+  report_stats(queue);
+
+  return true;
+}
+
+// Test capacity chosen per instance
+template <typename Queue>
+bool test_runtime_capacity() {
+  const size_t CAPACITY = 16;
+  Queue queue(CAPACITY);
+
+  TEST_ASSERT(queue.capacity() == CAPACITY, "Wrong capacity reported");
+
+  for (size_t i = 0; i < CAPACITY; ++i) {
+    TEST_ASSERT(queue.push(static_cast<int>(i)),
+                "Failed to push below capacity");
+  }
+  TEST_ASSERT(!queue.push(9999), "Queue should be full");
+
+  // Wrap around a few laps
+  for (size_t i = 0; i < 4 * CAPACITY; ++i) {
+    auto item = queue.pop();
+    TEST_ASSERT(item.has_value() && item.value() == static_cast<int>(i),
+                "Wrong item after wrap around");
+    TEST_ASSERT(queue.push(static_cast<int>(i + CAPACITY)),
+                "Failed to push after pop");
+  }
+
+  bool thrown = false;
+  try {
+    Queue invalid(CAPACITY + 1);
+  } catch (const std::invalid_argument&) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown, "Non power of 2 capacity should be rejected");
+
+  return true;
+}
+
+// Test slots come from the supplied allocator
+template <typename Queue>
+bool test_custom_allocator() {
+  const size_t allocations = AllocationCounter::allocations.load();
+  const size_t deallocations = AllocationCounter::deallocations.load();
+
+  {
+    Queue queue(64);
+    TEST_ASSERT(AllocationCounter::allocations.load() == allocations + 1,
+                "Slots not taken from the allocator");
+    TEST_ASSERT(queue.push(1), "Failed to push 1");
+    auto item = queue.pop();
+    TEST_ASSERT(item.has_value() && item.value() == 1, "Expected 1");
+  }
+
+  TEST_ASSERT(AllocationCounter::deallocations.load() == deallocations + 1,
+              "Slots not returned to the allocator");
+
+  return true;
+}
+
+// Test a burst is pushed and popped in order with single index updates
+template <typename Queue>
+bool test_batch_push_pop() {
+  Queue queue;
+  std::vector<int> burst(100);
+  std::iota(burst.begin(), burst.end(), 0);
+
+  TEST_ASSERT(queue.try_push_n(burst), "Failed to push burst");
+  TEST_ASSERT(queue.try_push_n(std::span<const int>{}),
+              "Empty burst should succeed");
+
+  std::vector<int> received;
+  TEST_ASSERT(queue.pop_bulk(std::back_inserter(received), 30) == 30,
+              "Expected 30 items limited by max");
+  TEST_ASSERT(queue.pop_bulk(std::back_inserter(received), 1000) == 70,
+              "Expected the remaining 70 items");
+  TEST_ASSERT(queue.pop_bulk(std::back_inserter(received), 1000) == 0,
+              "Expected empty queue");
+  TEST_ASSERT(received == burst, "Burst order not preserved");
+
+  return true;
+}
+
+// Test a burst that does not fit is rejected as a whole
+template <typename Queue>
+bool test_batch_all_or_nothing() {
+  const size_t CAPACITY = 64;
+  Queue queue(CAPACITY);
+  std::vector<int> burst(48, 7);
+
+  TEST_ASSERT(queue.try_push_n(burst), "Failed to push first burst");
+  TEST_ASSERT(!queue.try_push_n(burst), "Second burst should not fit");
+
+  std::vector<int> oversized(CAPACITY + 1, 7);
+  TEST_ASSERT(!queue.try_push_n(oversized),
+              "Burst above capacity should be rejected");
+
+  std::vector<int> received;
+  TEST_ASSERT(queue.pop_bulk(std::back_inserter(received), CAPACITY) == 48,
+              "Rejected burst must not leave partial items");
+
+  // Wrapping burst after the reader advanced
+  TEST_ASSERT(queue.try_push_n(burst), "Failed to push wrapping burst");
+  received.clear();
+  TEST_ASSERT(queue.pop_bulk(std::back_inserter(received), CAPACITY) == 48,
+              "Expected wrapping burst");
+
+  return true;
+}
+
+// Test bursts from many producers stay contiguous and nothing is lost
+template <typename Queue>
+bool test_batch_multiple_producers() {
+  Queue queue;
+  const int NUM_PRODUCERS = 4;
+  const int BURST = 64;
+  const int BURSTS_PER_PRODUCER = 100;
+  const int TOTAL_ITEMS = NUM_PRODUCERS * BURST * BURSTS_PER_PRODUCER;
+
+  std::atomic<bool> start{false};
+  std::vector<std::thread> producers;
+
+  for (int p = 0; p < NUM_PRODUCERS; ++p) {
+    producers.emplace_back([&, p]() {
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+
+      std::vector<int> burst(BURST);
+      for (int b = 0; b < BURSTS_PER_PRODUCER; ++b) {
+        for (int i = 0; i < BURST; ++i) {
+          burst[i] = (p << 20) | (b * BURST + i);
+        }
+        while (!queue.try_push_n(burst)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  start.store(true, std::memory_order_release);
+
+  std::vector<int> received;
+  received.reserve(TOTAL_ITEMS);
+  while (received.size() < static_cast<size_t>(TOTAL_ITEMS)) {
+    if (queue.pop_bulk(std::back_inserter(received), TOTAL_ITEMS) == 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  // Every burst was reserved as one range, so it must arrive unbroken
+  for (size_t i = 0; i < received.size(); i += BURST) {
+    for (int j = 1; j < BURST; ++j) {
+      if (received[i + j] != received[i] + j) {
+        std::cout << "  Burst interleaved at index " << i + j << std::endl;
+        return false;
+      }
+    }
+  }
+
+  std::sort(received.begin(), received.end());
+  auto last = std::unique(received.begin(), received.end());
+  TEST_ASSERT(last == received.end(), "Duplicate items detected!");
+
+  return true;
+}
+
+// Test move-only payloads travel through the queue without copies
+template <template <typename...> class QueueT>
+bool test_move_only_payload() {
+  QueueT<std::unique_ptr<int>> queue;
+
+  for (int i = 0; i < 10; ++i) {
+    TEST_ASSERT(queue.push(std::make_unique<int>(i)), "Failed to push");
+  }
+  TEST_ASSERT(queue.emplace(new int(10)), "Failed to emplace");
+
+  for (int i = 0; i <= 10; ++i) {
+    auto item = queue.pop();
+    TEST_ASSERT(item.has_value() && *item && **item == i,
+                "Expected moved out pointer");
+  }
+  TEST_ASSERT(!queue.pop().has_value(), "Expected empty queue");
+
+  return true;
+}
+
+// Test payloads are constructed on push only and destroyed with the queue
+template <template <typename...> class QueueT>
+bool test_in_place_payload_lifetime() {
+  TrackedPayload::live = 0;
+
+  {
+    QueueT<TrackedPayload> queue;
+    TEST_ASSERT(TrackedPayload::live == 0,
+                "Slots must not be constructed up front");
+
+    for (int i = 0; i < 10; ++i) {
+      TEST_ASSERT(queue.emplace(i), "Failed to emplace");
+    }
+    TEST_ASSERT(TrackedPayload::live == 10, "Expected one payload per push");
+
+    for (int i = 0; i < 3; ++i) {
+      auto item = queue.pop();
+      TEST_ASSERT(item.has_value() && item->value == i, "Wrong payload");
+    }
+    TEST_ASSERT(TrackedPayload::live == 7, "Popped slots must be destroyed");
+  }
+
+  TEST_ASSERT(TrackedPayload::live == 0,
+              "Queued payloads must be destroyed with the queue");
+
+  return true;
+}
+
+// Test a parked consumer receives every message from many producers
+template <typename Queue>
+bool test_pop_wait_multiple_producers() {
+  Queue queue(64);
+  const int NUM_PRODUCERS = 4;
+  const int ITEMS_PER_PRODUCER = 1000;
+  const int TOTAL_ITEMS = NUM_PRODUCERS * ITEMS_PER_PRODUCER;
+
+  std::vector<std::thread> producers;
+
+  for (int p = 0; p < NUM_PRODUCERS; ++p) {
+    producers.emplace_back([&, p]() {
+      for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+        int value = p * ITEMS_PER_PRODUCER + i;
+        while (!queue.push(value)) {
+          std::this_thread::yield();
+        }
+        if (i % 100 == 0) {
+          // Let the consumer drain and park
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+      }
+    });
+  }
+
+  std::set<int> received;
+  for (int i = 0; i < TOTAL_ITEMS; ++i) {
+    auto item = queue.pop_wait();
+    TEST_ASSERT(item.has_value(), "pop_wait returned without a message");
+    received.insert(item.value());
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  TEST_ASSERT(received.size() == static_cast<size_t>(TOTAL_ITEMS),
+              "Not all items received");
+  TEST_ASSERT(!queue.pop().has_value(), "Expected empty queue");
+
+  return true;
+}
+
+// Test pop_wait_for honours the timeout and wakes up on a push
+template <typename Queue>
+bool test_pop_wait_for_timeout() {
+  using namespace std::chrono_literals;
+  Queue queue;
+
+  auto start_time = std::chrono::steady_clock::now();
+  TEST_ASSERT(!queue.pop_wait_for(20ms).has_value(),
+              "Expected timeout on empty queue");
+  TEST_ASSERT(std::chrono::steady_clock::now() - start_time >= 20ms,
+              "Returned before the timeout");
+
+  std::thread producer([&]() {
+    std::this_thread::sleep_for(10ms);
+    (void)queue.push(42);
+  });
+
+  start_time = std::chrono::steady_clock::now();
+  auto item = queue.pop_wait_for(5s);
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+  producer.join();
+
+  TEST_ASSERT(item.has_value() && item.value() == 42, "Expected 42");
+  TEST_ASSERT(elapsed < 1s, "Consumer was not woken up by the push");
+
+  return true;
+}
+
+// Test an unbounded queue keeps accepting past any fixed capacity and
+// reuses its nodes once drained
+template <typename Queue>
+bool test_unbounded_growth() {
+  Queue queue;
+  const int ITEMS = 16 * MPSC_QUEUE_CAPACITY;
+
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < ITEMS; ++i) {
+      TEST_ASSERT(queue.push(i), "Unbounded push must not fail");
+    }
+    for (int i = 0; i < ITEMS; ++i) {
+      auto item = queue.pop();
+      TEST_ASSERT(item.has_value() && item.value() == i,
+                  "Wrong item after growth");
+    }
+    TEST_ASSERT(!queue.pop().has_value(), "Expected empty queue");
+  }
+
+  return true;
+}
+
+// Test every producer's lane is drained, in order, by pop and pop_bulk
+bool test_sharded_multiple_producers() {
+  ShardedMPSC<int> queue;
+  const int NUM_PRODUCERS = 8;
+  const int ITEMS_PER_PRODUCER = 2000;
+  const int TOTAL_ITEMS = NUM_PRODUCERS * ITEMS_PER_PRODUCER;
+
+  std::atomic<bool> start{false};
+  std::vector<std::thread> producers;
+
+  for (int p = 0; p < NUM_PRODUCERS; ++p) {
+    producers.emplace_back([&, p]() {
+      auto producer = queue.registerProducer();
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+
+      for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+        while (!producer.push((p << 20) | i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  start.store(true, std::memory_order_release);
+
+  std::vector<int> last_seq(NUM_PRODUCERS, -1);
+  std::vector<int> batch;
+  int consumed = 0;
+
+  while (consumed < TOTAL_ITEMS) {
+    // Alternate single and bulk pops
+    batch.clear();
+    if (consumed % 2 == 0) {
+      if (auto item = queue.pop()) {
+        batch.push_back(item.value());
+      }
+    } else {
+      queue.pop_bulk(std::back_inserter(batch), 64);
+    }
+
+    if (batch.empty()) {
+      std::this_thread::yield();
+    }
+    for (int value : batch) {
+      int producer_id = value >> 20;
+      int sequence = value & 0xFFFFF;
+      if (sequence != last_seq[producer_id] + 1) {
+        std::cout << "  FIFO violation for producer " << producer_id
+                  << ": got sequence " << sequence << " after "
+                  << last_seq[producer_id] << std::endl;
+        return false;
+      }
+      last_seq[producer_id] = sequence;
+      consumed++;
+    }
+  }
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  TEST_ASSERT(!queue.pop().has_value(), "Expected empty queue");
+
+  return true;
+}
+
+// Test registration fails once every lane is taken
+bool test_sharded_lane_exhaustion() {
+  ShardedMPSC<int, 16, 2> queue;
+
+  auto first = queue.registerProducer();
+  auto second = queue.registerProducer();
+
+  bool thrown = false;
+  try {
+    (void)queue.registerProducer();
+  } catch (const std::length_error&) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown, "Third producer should be rejected");
+
+  TEST_ASSERT(first.push(1) && second.push(2), "Failed to push");
+  std::vector<int> received;
+  TEST_ASSERT(queue.pop_bulk(std::back_inserter(received), 10) == 2,
+              "Expected both lanes drained");
 
   return true;
 }
 
+#if defined(__linux__)
+// Forked producer processes, killed and reaped on every way out of a test so
+// a failed check does not leave them spinning on a full queue
+struct ChildProcesses {
+  std::vector<pid_t> pids;
+
+  ~ChildProcesses() {
+    for (pid_t pid : pids) {
+      kill(pid, SIGKILL);
+      waitpid(pid, nullptr, 0);
+    }
+  }
+
+  // Waits for every process to exit, true if all of them exited with 0
+  bool wait_all() {
+    bool ok = true;
+    for (pid_t pid : pids) {
+      int status = 0;
+      waitpid(pid, &status, 0);
+      ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    pids.clear();
+    return ok;
+  }
+};
+
+// Test producers in forked processes reach the consumer through a named
+// shared memory queue, with no lost, duplicate or reordered messages
+bool test_shared_memory_multi_process() {
+  using namespace std::chrono_literals;
+  const std::string name = "/mpsc_queue_test_" + std::to_string(getpid());
+  auto queue = MPSCSharedQueue<int>::create(name, 256);
+  const int NUM_PRODUCERS = 4;
+  const int ITEMS_PER_PRODUCER = 20000;
+  const int TOTAL_ITEMS = NUM_PRODUCERS * ITEMS_PER_PRODUCER;
+
+  ChildProcesses children;
+  for (int p = 0; p < NUM_PRODUCERS; ++p) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // Child attaches by name like an unrelated process would; _exit
+      // skips the destructors so the inherited owner does not unlink
+      int status = 0;
+      try {
+        auto producer = MPSCSharedQueue<int>::attach(name);
+        for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+          int value = (p << 20) | i;
+          // Odd producers push pairs to exercise try_push_n across laps
+          if (p % 2 == 1 && i + 1 < ITEMS_PER_PRODUCER) {
+            const int pair[] = {value, value + 1};
+            while (!producer.try_push_n(pair)) {
+              std::this_thread::yield();
+            }
+            ++i;
+          } else {
+            while (!producer.push(value)) {
+              std::this_thread::yield();
+            }
+          }
+        }
+      } catch (...) {
+        status = 1;
+      }
+      _exit(status);
+    }
+    TEST_ASSERT(pid > 0, "fork failed");
+    children.pids.push_back(pid);
+  }
+
+  std::vector<int> last_seq(NUM_PRODUCERS, -1);
+  std::vector<int> batch;
+  int consumed = 0;
+  const auto deadline = std::chrono::steady_clock::now() + 30s;
+
+  while (consumed < TOTAL_ITEMS &&
+         std::chrono::steady_clock::now() < deadline) {
+    batch.clear();
+    if (consumed % 2 == 0) {
+      if (auto item = queue.pop()) {
+        batch.push_back(item.value());
+      }
+    } else {
+      queue.pop_bulk(std::back_inserter(batch), 64);
+    }
+
+    if (batch.empty()) {
+      std::this_thread::yield();
+    }
+    for (int value : batch) {
+      int producer_id = value >> 20;
+      int sequence = value & 0xFFFFF;
+      TEST_ASSERT(producer_id < NUM_PRODUCERS, "Corrupted message");
+      TEST_ASSERT(sequence == last_seq[producer_id] + 1,
+                  "FIFO violation across processes");
+      last_seq[producer_id] = sequence;
+      consumed++;
+    }
+  }
+
+  // Before waiting: producers that did not finish may block on a full queue
+  TEST_ASSERT(consumed == TOTAL_ITEMS, "Not all items received");
+  TEST_ASSERT(children.wait_all(), "A producer process failed");
+  TEST_ASSERT(!queue.pop().has_value(), "Expected empty queue");
+
+  return true;
+}
+
+// Test attach sees the creator's state and rejects missing, duplicate and
+// mismatching regions
+bool test_shared_memory_attach_checks() {
+  const std::string name =
+      "/mpsc_queue_test_attach_" + std::to_string(getpid());
+
+  {
+    auto queue = MPSCSharedQueue<int>::create(name, 64);
+    TEST_ASSERT(queue.capacity() == 64, "Wrong capacity reported");
+    TEST_ASSERT(queue.push(7), "Failed to push 7");
+
+    auto attached = MPSCSharedQueue<int>::attach(name);
+    TEST_ASSERT(attached.capacity() == 64, "Attached capacity differs");
+    auto item = attached.pop();
+    TEST_ASSERT(item.has_value() && item.value() == 7, "Expected 7");
+
+    bool duplicate = false;
+    try {
+      (void)MPSCSharedQueue<int>::create(name, 64);
+    } catch (const std::system_error&) {
+      duplicate = true;
+    }
+    TEST_ASSERT(duplicate, "Creating an existing name should fail");
+
+    bool wrong_type = false;
+    try {
+      (void)MPSCSharedQueue<int64_t>::attach(name);
+    } catch (const std::system_error&) {
+    } catch (const std::runtime_error&) {
+      wrong_type = true;
+    }
+    TEST_ASSERT(wrong_type, "Attaching with another message type should fail");
+  }
+
+  // The owner unlinked the name on destruction
+  bool missing = false;
+  try {
+    (void)MPSCSharedQueue<int>::attach(name);
+  } catch (const std::system_error&) {
+    missing = true;
+  }
+  TEST_ASSERT(missing, "Attaching to a removed queue should fail");
+
+  return true;
+}
+#endif
+
+// Bounded queues take the capacity, unbounded ones ignore it
+template <typename Queue>
+std::unique_ptr<Queue> make_queue(size_t capacity) {
+  if constexpr (std::is_constructible_v<Queue, size_t>) {
+    return std::make_unique<Queue>(capacity);
+  } else {
+    return std::make_unique<Queue>();
+  }
+}
+
+// Test the instrumentation counts each event and records every latency
+template <typename Queue>
+bool test_stats_counters() {
+  const size_t CAPACITY = 8;
+  Queue queue(CAPACITY);
+
+  TEST_ASSERT(!queue.pop().has_value(), "Expected empty queue");
+  for (size_t i = 0; i < CAPACITY; ++i) {
+    TEST_ASSERT(queue.push(static_cast<int>(i)), "Failed to push");
+  }
+  TEST_ASSERT(!queue.push(9999), "Queue should be full");
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  for (size_t i = 0; i < CAPACITY; ++i) {
+    TEST_ASSERT(queue.pop().has_value(), "Failed to pop");
+  }
+
+  auto stats = queue.stats().snapshot();
+  TEST_ASSERT(stats.emptyPolls == 1, "Expected one empty poll");
+  TEST_ASSERT(stats.fullRejections == 1, "Expected one full rejection");
+  TEST_ASSERT(stats.reserveRetries == 0 && stats.commitSpins == 0,
+              "No contention expected from a single thread");
+  TEST_ASSERT(stats.latency.total == CAPACITY, "Expected one latency per pop");
+  TEST_ASSERT(stats.latency.percentile(50) >= 1000000 * 15 / 16,
+              "Latency should include the 1 ms sleep");
+  TEST_ASSERT(stats.latency.max >= stats.latency.percentile(100),
+              "Max below the highest bucket");
+
+  // Every bucket's lower bound maps back to that bucket
+  for (size_t b = 0; b < MPSCLatencyHistogram::BUCKETS; ++b) {
+    TEST_ASSERT(MPSCLatencyHistogram::bucketOf(
+                    MPSCLatencyHistogram::lowerBoundOf(b)) == b,
+                "Histogram bucket bounds inconsistent");
+  }
+
+  return true;
+}
+
+// Measures items/sec through one consumer draining NUM_PRODUCERS producers
+template <typename Queue>
+double measure_throughput(int num_producers, int items_per_producer,
+                          size_t capacity = MPSC_QUEUE_CAPACITY) {
+  auto queue_ptr = make_queue<Queue>(capacity);
+  Queue& queue = *queue_ptr;
+  const int TOTAL_ITEMS = num_producers * items_per_producer;
+
+  std::atomic<bool> start{false};
+  std::vector<std::thread> producers;
+
+  for (int p = 0; p < num_producers; ++p) {
+    producers.emplace_back([&, p]() {
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+
+      for (int i = 0; i < items_per_producer; ++i) {
+        int value = p * items_per_producer + i;
+        while (!queue.push(value)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+
+  int consumed = 0;
+  while (consumed < TOTAL_ITEMS) {
+    if (queue.pop().has_value()) {
+      consumed++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  return TOTAL_ITEMS / std::chrono::duration<double>(elapsed).count();
+}
+
+// Compares the commit-CAS, per-slot sequence and linked queues
+void benchmark_producer_scaling() {
+  const int TOTAL_ITEMS = 1 << 18;
+
+  std::cout << "\n[BENCHMARK] Producer scaling, " << TOTAL_ITEMS
+            << " items, Mops/s" << std::endl;
+  std::cout << "  " << std::setw(10) << "Producers" << std::setw(14)
+            << "MPSCQueue" << std::setw(22) << "MPSCSequencedQueue"
+            << std::setw(18) << "MPSCLinkedQueue" << std::endl;
+
+  for (int producers : {1, 2, 4, 8, 16, 32}) {
+    const int items_per_producer = TOTAL_ITEMS / producers;
+    double commit =
+        measure_throughput<MPSCQueue<int>>(producers, items_per_producer);
+    double sequenced = measure_throughput<MPSCSequencedQueue<int>>(
+        producers, items_per_producer);
+    double linked =
+        measure_throughput<MPSCLinkedQueue<int>>(producers, items_per_producer);
+
+    std::cout << "  " << std::setw(10) << producers << std::fixed
+              << std::setprecision(2) << std::setw(14) << commit / 1e6
+              << std::setw(22) << sequenced / 1e6 << std::setw(18)
+              << linked / 1e6 << std::endl;
+  }
+}
+
+// Measures items/sec of a sharded queue, one registered lane per producer
+double measure_sharded_throughput(int num_producers, int items_per_producer,
+                                  bool bulk) {
+  ShardedMPSC<int> queue;
+  const int TOTAL_ITEMS = num_producers * items_per_producer;
+
+  std::atomic<bool> start{false};
+  std::vector<std::thread> producers;
+
+  for (int p = 0; p < num_producers; ++p) {
+    producers.emplace_back([&, p]() {
+      auto producer = queue.registerProducer();
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+
+      for (int i = 0; i < items_per_producer; ++i) {
+        while (!producer.push(p * items_per_producer + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+
+  std::vector<int> received(256);
+  int consumed = 0;
+  while (consumed < TOTAL_ITEMS) {
+    size_t count = 0;
+    if (bulk) {
+      count = queue.pop_bulk(received.begin(), received.size());
+    } else if (queue.pop().has_value()) {
+      count = 1;
+    }
+
+    if (count == 0) {
+      std::this_thread::yield();
+    }
+    consumed += static_cast<int>(count);
+  }
+
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  return TOTAL_ITEMS / std::chrono::duration<double>(elapsed).count();
+}
+
+// Compares the shared write index of MPSCQueue with per-producer lanes
+void benchmark_sharded_lanes() {
+  const int TOTAL_ITEMS = 1 << 18;
+
+  std::cout << "\n[BENCHMARK] Sharded lanes, " << TOTAL_ITEMS
+            << " items, Mops/s" << std::endl;
+  std::cout << "  " << std::setw(10) << "Producers" << std::setw(14)
+            << "MPSCQueue" << std::setw(16) << "ShardedMPSC" << std::setw(22)
+            << "ShardedMPSC bulk" << std::endl;
+
+  for (int producers : {2, 4, 8, 16, 32, 64}) {
+    const int items_per_producer = TOTAL_ITEMS / producers;
+    double shared =
+        measure_throughput<MPSCQueue<int>>(producers, items_per_producer);
+    double sharded =
+        measure_sharded_throughput(producers, items_per_producer, false);
+    double sharded_bulk =
+        measure_sharded_throughput(producers, items_per_producer, true);
+
+    std::cout << "  " << std::setw(10) << producers << std::fixed
+              << std::setprecision(2) << std::setw(14) << shared / 1e6
+              << std::setw(16) << sharded / 1e6 << std::setw(22)
+              << sharded_bulk / 1e6 << std::endl;
+  }
+}
+
+// Throughput of both queues against the per-instance capacity
+void benchmark_capacity_scaling() {
+  const int TOTAL_ITEMS = 1 << 18;
+  const int PRODUCERS = 4;
+
+  std::cout << "\n[BENCHMARK] Capacity scaling, " << PRODUCERS
+            << " producers, " << TOTAL_ITEMS << " items, Mops/s" << std::endl;
+  std::cout << "  " << std::setw(10) << "Capacity" << std::setw(14)
+            << "MPSCQueue" << std::setw(22) << "MPSCSequencedQueue"
+            << std::endl;
+
+  for (size_t capacity : {64, 256, 1024, 4096, 16384}) {
+    const int items_per_producer = TOTAL_ITEMS / PRODUCERS;
+    double commit = measure_throughput<MPSCQueue<int>>(
+        PRODUCERS, items_per_producer, capacity);
+    double sequenced = measure_throughput<MPSCSequencedQueue<int>>(
+        PRODUCERS, items_per_producer, capacity);
+
+    std::cout << "  " << std::setw(10) << capacity << std::fixed
+              << std::setprecision(2) << std::setw(14) << commit / 1e6
+              << std::setw(22) << sequenced / 1e6 << std::endl;
+  }
+}
+
+// Measures items/sec when producers emit bursts of burst_size items
+template <typename Queue>
+double measure_batch_throughput(int num_producers, int items_per_producer,
+                                int burst_size, bool batched) {
+  Queue queue;
+  const int TOTAL_ITEMS = num_producers * items_per_producer;
+
+  std::atomic<bool> start{false};
+  std::vector<std::thread> producers;
+
+  for (int p = 0; p < num_producers; ++p) {
+    producers.emplace_back([&, p]() {
+      while (!start.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+
+      std::vector<int> burst(burst_size);
+      for (int i = 0; i < items_per_producer; i += burst_size) {
+        std::iota(burst.begin(), burst.end(), p * items_per_producer + i);
+        if (batched) {
+          while (!queue.try_push_n(burst)) {
+            std::this_thread::yield();
+          }
+        } else {
+          for (int value : burst) {
+            while (!queue.push(value)) {
+              std::this_thread::yield();
+            }
+          }
+        }
+      }
+    });
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  start.store(true, std::memory_order_release);
+
+  std::vector<int> received(burst_size);
+  int consumed = 0;
+  while (consumed < TOTAL_ITEMS) {
+    size_t count = 0;
+    if (batched) {
+      count = queue.pop_bulk(received.begin(), received.size());
+    } else if (queue.pop().has_value()) {
+      count = 1;
+    }
+
+    if (count == 0) {
+      std::this_thread::yield();
+    }
+    consumed += static_cast<int>(count);
+  }
+
+  auto elapsed = std::chrono::steady_clock::now() - start_time;
+
+  for (auto& t : producers) {
+    t.join();
+  }
+
+  return TOTAL_ITEMS / std::chrono::duration<double>(elapsed).count();
+}
+
+// Compares push/pop per item with try_push_n/pop_bulk per burst
+void benchmark_batch_operations() {
+  const int TOTAL_ITEMS = 1 << 18;
+  const int PRODUCERS = 4;
+
+  std::cout << "\n[BENCHMARK] Batch operations, " << PRODUCERS
+            << " producers, " << TOTAL_ITEMS << " items, Mops/s" << std::endl;
+  std::cout << "  " << std::setw(10) << "Burst" << std::setw(14) << "push/pop"
+            << std::setw(22) << "try_push_n/pop_bulk" << std::endl;
+
+  for (int burst : {64, 256}) {
+    const int items_per_producer = TOTAL_ITEMS / PRODUCERS;
+    double single = measure_batch_throughput<MPSCQueue<int>>(
+        PRODUCERS, items_per_producer, burst, false);
+    double batched = measure_batch_throughput<MPSCQueue<int>>(
+        PRODUCERS, items_per_producer, burst, true);
+
+    std::cout << "  " << std::setw(10) << burst << std::fixed
+              << std::setprecision(2) << std::setw(14) << single / 1e6
+              << std::setw(22) << batched / 1e6 << std::endl;
+  }
+}
+
+// CPU time consumed by the calling thread
+std::chrono::nanoseconds thread_cpu_time() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+// Wake-up latency of a consumer waiting on an empty queue, sorted, in us
+std::vector<double> measure_wakeup_latency(bool blocking) {
+  const int MESSAGES = 200;
+  MPSCQueue<std::chrono::steady_clock::time_point> queue;
+  std::vector<double> latencies;
+  latencies.reserve(MESSAGES);
+
+  std::thread producer([&]() {
+    for (int i = 0; i < MESSAGES; ++i) {
+      std::this_thread::sleep_for(std::chrono::microseconds(500));
+      while (!queue.push(std::chrono::steady_clock::now())) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  for (int i = 0; i < MESSAGES; ++i) {
+    std::optional<std::chrono::steady_clock::time_point> sent;
+    if (blocking) {
+      sent = queue.pop_wait();
+    } else {
+      while (!(sent = queue.pop()).has_value()) {
+        std::this_thread::yield();
+      }
+    }
+    latencies.push_back(std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - sent.value())
+                            .count());
+  }
+
+  producer.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  return latencies;
+}
+
+// CPU time of a consumer waiting 200 ms on an empty queue, in ms
+double measure_idle_cpu(bool blocking) {
+  using namespace std::chrono_literals;
+  MPSCQueue<int> queue;
+  double cpu_ms = 0;
+
+  std::thread consumer([&]() {
+    auto cpu_start = thread_cpu_time();
+    if (blocking) {
+      (void)queue.pop_wait_for(200ms);
+    } else {
+      auto deadline = std::chrono::steady_clock::now() + 200ms;
+      while (!queue.pop().has_value() &&
+             std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+      }
+    }
+    cpu_ms = std::chrono::duration<double, std::milli>(thread_cpu_time() -
+                                                       cpu_start)
+                 .count();
+  });
+  consumer.join();
+
+  return cpu_ms;
+}
+
+// Compares a yield-spinning consumer with one parked in pop_wait
+void benchmark_blocking_consumer() {
+  std::cout << "\n[BENCHMARK] Blocking consumer, wake-up latency in us, "
+            << "idle CPU in ms per 200 ms" << std::endl;
+  std::cout << "  " << std::setw(12) << "Consumer" << std::setw(10) << "p50"
+            << std::setw(10) << "p99" << std::setw(12) << "Idle CPU"
+            << std::endl;
+
+  for (bool blocking : {false, true}) {
+    auto latencies = measure_wakeup_latency(blocking);
+    double idle_cpu = measure_idle_cpu(blocking);
+
+    std::cout << "  " << std::setw(12) << (blocking ? "pop_wait" : "spin/yield")
+              << std::fixed << std::setprecision(2) << std::setw(10)
+              << latencies[latencies.size() / 2] << std::setw(10)
+              << latencies[latencies.size() * 99 / 100] << std::setw(12)
+              << idle_cpu << std::endl;
+  }
+}
+
 int main() {
   std::cout << "========================================" << std::endl;
   std::cout << "  MPSC Queue Concurrency Tests" << std::endl;
   std::cout << "========================================" << std::endl;
 
-  RUN_TEST(test_single_threaded_basic);
-  RUN_TEST(test_capacity_limit);
-  RUN_TEST(test_multiple_producers_single_consumer);
-  RUN_TEST(test_high_contention_stress);
-  RUN_TEST(test_fifo_ordering_per_producer);
-  RUN_TEST(test_full_queue_behavior);
-  RUN_TEST(test_alternating_push_pop);
-  RUN_TEST(test_variable_rate_producers);
+  RUN_TEST(test_single_threaded_basic<MPSCQueue<int>>);
+  RUN_TEST(test_capacity_limit<MPSCQueue<int>>);
+  RUN_TEST(test_multiple_producers_single_consumer<MPSCQueue<int>>);
+  RUN_TEST(test_high_contention_stress<MPSCQueue<int>>);
+  RUN_TEST(test_fifo_ordering_per_producer<MPSCQueue<int>>);
+  RUN_TEST(test_full_queue_behavior<MPSCQueue<int>>);
+  RUN_TEST(test_alternating_push_pop<MPSCQueue<int>>);
+  RUN_TEST(test_variable_rate_producers<MPSCQueue<int>>);
+  RUN_TEST(test_runtime_capacity<MPSCQueue<int>>);
+  RUN_TEST(test_custom_allocator<MPSCQueue<int, CountingAllocator<int>>>);
+  RUN_TEST(test_move_only_payload<MPSCQueue>);
+  RUN_TEST(test_in_place_payload_lifetime<MPSCQueue>);
+  RUN_TEST(test_batch_push_pop<MPSCQueue<int>>);
+  RUN_TEST(test_batch_all_or_nothing<MPSCQueue<int>>);
+  RUN_TEST(test_batch_multiple_producers<MPSCQueue<int>>);
+  RUN_TEST(test_pop_wait_multiple_producers<MPSCQueue<int>>);
+  RUN_TEST(test_pop_wait_for_timeout<MPSCQueue<int>>);
+  RUN_TEST(test_stats_counters<InstrumentedMPSCQueue>);
+  RUN_TEST(test_high_contention_stress<InstrumentedMPSCQueue>);
+  RUN_TEST(test_variable_rate_producers<InstrumentedMPSCQueue>);
+
+  RUN_TEST(test_single_threaded_basic<MPSCSequencedQueue<int>>);
+  RUN_TEST(test_capacity_limit<MPSCSequencedQueue<int>>);
+  RUN_TEST(test_multiple_producers_single_consumer<MPSCSequencedQueue<int>>);
+  RUN_TEST(test_high_contention_stress<MPSCSequencedQueue<int>>);
+  RUN_TEST(test_fifo_ordering_per_producer<MPSCSequencedQueue<int>>);
+  RUN_TEST(test_full_queue_behavior<MPSCSequencedQueue<int>>);
+  RUN_TEST(test_alternating_push_pop<MPSCSequencedQueue<int>>);
+  RUN_TEST(test_variable_rate_producers<MPSCSequencedQueue<int>>);
+  RUN_TEST(test_runtime_capacity<MPSCSequencedQueue<int>>);
+  RUN_TEST(test_custom_allocator<
+           MPSCSequencedQueue<int, CountingAllocator<int>>>);
+  RUN_TEST(test_move_only_payload<MPSCSequencedQueue>);
+  RUN_TEST(test_in_place_payload_lifetime<MPSCSequencedQueue>);
+
+  RUN_TEST(test_single_threaded_basic<MPSCLinkedQueue<int>>);
+  RUN_TEST(test_multiple_producers_single_consumer<MPSCLinkedQueue<int>>);
+  RUN_TEST(test_high_contention_stress<MPSCLinkedQueue<int>>);
+  RUN_TEST(test_fifo_ordering_per_producer<MPSCLinkedQueue<int>>);
+  RUN_TEST(test_alternating_push_pop<MPSCLinkedQueue<int>>);
+  RUN_TEST(test_variable_rate_producers<MPSCLinkedQueue<int>>);
+  RUN_TEST(test_move_only_payload<MPSCLinkedQueue>);
+  RUN_TEST(test_in_place_payload_lifetime<MPSCLinkedQueue>);
+  RUN_TEST(test_unbounded_growth<MPSCLinkedQueue<int>>);
+
+  RUN_TEST(test_sharded_multiple_producers);
+  RUN_TEST(test_sharded_lane_exhaustion);
+
+#if defined(__linux__)
+  RUN_TEST(test_shared_memory_multi_process);
+  RUN_TEST(test_shared_memory_attach_checks);
+#endif
 
   std::cout << "\n========================================" << std::endl;
   std::cout << "  Test Summary" << std::endl;
@@ -436,5 +1522,11 @@ int main() {
   std::cout << "Failed:       " << failed_tests << " ✗" << std::endl;
   std::cout << "========================================" << std::endl;
 
+  benchmark_producer_scaling();
+  benchmark_capacity_scaling();
+  benchmark_batch_operations();
+  benchmark_blocking_consumer();
+  benchmark_sharded_lanes();
+
   return (failed_tests == 0) ? 0 : 1;
 }
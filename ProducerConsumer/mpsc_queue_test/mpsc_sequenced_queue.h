@@ -0,0 +1,167 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "mpsc_queue.h"
+
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+// Multiple-producer, single-consumer ring-buffer queue with a sequence
+// stamp per slot (Dmitry Vyukov's bounded queue, single consumer side).
+// Producers only contend on writeIndex for reservation and then publish
+// their own slot independently: there is no commit step that waits for
+// earlier producers, so a preempted producer does not stall the others.
+// Producer: CAS(writeIndex) -> write -> store(slot.sequence)
+// Consumer reads the slot at readIndex once its stamp says it is published.
+//
+// Slot sequence for position pos:
+//  - pos               : slot is free for the producer of pos
+//  - pos + 1           : slot is published for the consumer
+//  - pos + capacity    : slot was consumed, free for the next lap
+//
+// Memory ordering:
+//  - Producers publish writes with `release` on slot.sequence
+//  - Consumer observes published writes with `acquire`
+//  - Consumer releases the slot with `release`, producers take it with
+//    `acquire`
+//
+// Capacity, cache-line separation, Allocator and in-place slot storage
+// follow MPSCQueue.
+
+template <typename T, typename Allocator = std::allocator<T>>
+class MPSCSequencedQueue {
+ public:
+  explicit MPSCSequencedQueue(size_t capacity = MPSC_QUEUE_CAPACITY,
+                              const Allocator& alloc = Allocator());
+  ~MPSCSequencedQueue();
+
+  MPSCSequencedQueue(const MPSCSequencedQueue&) = delete;
+  MPSCSequencedQueue& operator=(const MPSCSequencedQueue&) = delete;
+
+  [[nodiscard]] std::optional<T> pop() noexcept;
+  [[nodiscard]] bool push(const T& msg) noexcept;
+  [[nodiscard]] bool push(T&& msg) noexcept;
+
+  template <typename... Args>
+  [[nodiscard]] bool emplace(Args&&... args) noexcept;
+
+  [[nodiscard]] size_t capacity() const noexcept { return slotCount; }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    alignas(T) std::byte storage[sizeof(T)];
+
+    T* data() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
+  };
+
+  using SlotAllocator =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<Slot>;
+  using SlotAllocatorTraits = std::allocator_traits<SlotAllocator>;
+
+  // Read-only after construction
+  [[no_unique_address]] SlotAllocator allocator;
+  const size_t slotCount;
+  const size_t maxIndexMask;
+  Slot* buf = nullptr;
+
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<size_t> writeIndex{0};
+  // Owned by the single consumer, never touched by producers
+  alignas(MPSC_QUEUE_CACHE_LINE_SIZE) size_t readIndex = 0;
+};
+
+template <typename T, typename Allocator>
+MPSCSequencedQueue<T, Allocator>::MPSCSequencedQueue(size_t capacity,
+                                                     const Allocator& alloc)
+    : allocator(alloc), slotCount(capacity), maxIndexMask(capacity - 1) {
+  static_assert(
+      std::atomic<size_t>::is_always_lock_free,
+      "MPSCSequencedQueue requires lock-free atomics for correctness");
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    throw std::invalid_argument(
+        "MPSCSequencedQueue algorithms are optimised for and intended to work "
+        "only with capacity of power of 2");
+  }
+
+  buf = SlotAllocatorTraits::allocate(allocator, slotCount);
+  for (size_t i = 0; i < slotCount; ++i) {
+    std::construct_at(&buf[i].sequence, i);
+  }
+}
+
+template <typename T, typename Allocator>
+MPSCSequencedQueue<T, Allocator>::~MPSCSequencedQueue() {
+  // Destroy messages published but not consumed yet
+  for (size_t r = readIndex;; ++r) {
+    Slot& slot = buf[r & maxIndexMask];
+    if (slot.sequence.load(std::memory_order_acquire) != r + 1) {
+      break;
+    }
+    std::destroy_at(slot.data());
+  }
+  SlotAllocatorTraits::deallocate(allocator, buf, slotCount);
+}
+
+template <typename T, typename Allocator>
+bool MPSCSequencedQueue<T, Allocator>::push(const T& msg) noexcept {
+  return emplace(msg);
+}
+
+template <typename T, typename Allocator>
+bool MPSCSequencedQueue<T, Allocator>::push(T&& msg) noexcept {
+  return emplace(std::move(msg));
+}
+
+template <typename T, typename Allocator>
+template <typename... Args>
+bool MPSCSequencedQueue<T, Allocator>::emplace(Args&&... args) noexcept {
+  size_t pos = writeIndex.load(std::memory_order_relaxed);
+
+  while (true) {
+    Slot& slot = buf[pos & maxIndexMask];
+    size_t seq = slot.sequence.load(std::memory_order_acquire);
+    auto diff =
+        static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+
+    if (diff == 0) {
+      // Slot is free for this lap, try to claim the position
+      if (writeIndex.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed)) {
+        std::construct_at(reinterpret_cast<T*>(slot.storage),
+                          std::forward<Args>(args)...);
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+      // CAS failure reloaded pos
+    } else if (diff < 0) {
+      // Slot still holds the previous lap, the consumer has not freed it
+      return false;
+    } else {
+      // Another producer took this position, catch up
+      pos = writeIndex.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename T, typename Allocator>
+std::optional<T> MPSCSequencedQueue<T, Allocator>::pop() noexcept {
+  Slot& slot = buf[readIndex & maxIndexMask];
+  size_t seq = slot.sequence.load(std::memory_order_acquire);
+
+  if (seq != readIndex + 1) {
+    // buffer empty, or the producer of readIndex has not published yet
+    return std::nullopt;
+  }
+
+  std::optional<T> msg(std::in_place, std::move(*slot.data()));
+  std::destroy_at(slot.data());
+
+  slot.sequence.store(readIndex + slotCount, std::memory_order_release);
+  ++readIndex;
+
+  return msg;
+}
@@ -0,0 +1,361 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "mpsc_queue.h"
+
+// MPSCQueue whose indices and slots live in a POSIX shared memory region,
+// so producers in other processes on the same host can push into it.
+// Producer: CAS(reserve) -> memcpy -> CAS(commit), as in MPSCQueue
+// Consumer reads only committed slots.
+//
+// Region:
+//  - create(name, capacity) makes a new region and owns it, the name is
+//    unlinked when the owning queue is destroyed
+//  - attach(name) maps an existing region, typically from a producer
+//    process, and checks it was created with the same layout and T
+//  - The header is published last with `release`, attach refuses a region
+//    whose magic is not set yet
+//  - MPSC_SHARED_QUEUE_LAYOUT_VERSION must change with the header or slot
+//    placement, so binaries built against another layout fail to attach
+//
+// Restrictions:
+//  - T must be trivially copyable, messages are copied as bytes and
+//    nothing in the region may point into one process' address space
+//  - The atomics must be always lock-free, otherwise they would be guarded
+//    by a process-local lock
+//  - There is no blocking consumer, the semaphore of MPSCQueue is
+//    process-local
+//
+// Caveat: a producer that dies between reserve and commit stalls every
+// later producer, like a preempted one in MPSCQueue, but forever.
+
+// Bumped whenever Header or the slot placement changes
+const uint32_t MPSC_SHARED_QUEUE_LAYOUT_VERSION = 1;
+
+template <typename T>
+class MPSCSharedQueue {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "MPSCSharedQueue copies messages between processes as bytes");
+  static_assert(alignof(T) <= MPSC_QUEUE_CACHE_LINE_SIZE,
+                "MPSCSharedQueue slots are aligned to a cache line at most");
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                "MPSCSharedQueue requires lock-free atomics to be shared "
+                "between processes");
+
+ public:
+  // Throws std::invalid_argument for a capacity not a power of 2 and
+  // std::system_error when the name exists or the region cannot be mapped
+  [[nodiscard]] static MPSCSharedQueue create(
+      const std::string& name, size_t capacity = MPSC_QUEUE_CAPACITY);
+  // Throws std::system_error when the region cannot be opened and
+  // std::runtime_error when its layout or message type does not match
+  [[nodiscard]] static MPSCSharedQueue attach(const std::string& name);
+
+  MPSCSharedQueue(MPSCSharedQueue&& other) noexcept;
+  ~MPSCSharedQueue();
+
+  MPSCSharedQueue(const MPSCSharedQueue&) = delete;
+  MPSCSharedQueue& operator=(const MPSCSharedQueue&) = delete;
+  MPSCSharedQueue& operator=(MPSCSharedQueue&&) = delete;
+
+  // Consumer side, one process and thread at a time
+  [[nodiscard]] std::optional<T> pop() noexcept;
+  template <typename OutputIt>
+  size_t pop_bulk(OutputIt out, size_t max);
+
+  [[nodiscard]] bool push(const T& msg) noexcept;
+  // Pushes all of msgs or nothing
+  [[nodiscard]] bool try_push_n(std::span<const T> msgs) noexcept;
+
+  [[nodiscard]] size_t capacity() const noexcept { return slotCount; }
+
+ private:
+  static constexpr uint64_t MAGIC = 0x4d50534353484d51;  // "MPSCSHMQ"
+
+  struct Header {
+    // Set last by create, until then the other fields are not valid
+    std::atomic<uint64_t> magic{0};
+    uint32_t layoutVersion = 0;
+    uint32_t slotSize = 0;
+    uint32_t slotAlign = 0;
+    uint64_t slotCount = 0;
+
+    alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<uint64_t> readIndex{0};
+    alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<uint64_t> commitWriteIndex{
+        0};
+    alignas(MPSC_QUEUE_CACHE_LINE_SIZE) std::atomic<uint64_t>
+        reserveWriteIndex{0};
+  };
+
+  MPSCSharedQueue(const std::string& n, void* r, size_t size, bool owns);
+
+  static size_t regionSizeFor(size_t capacity) noexcept {
+    return sizeof(Header) + capacity * sizeof(T);
+  }
+
+  std::byte* slotAt(uint64_t index) const noexcept {
+    return slots + (index & maxIndexMask) * sizeof(T);
+  }
+
+  bool reserve(size_t count, uint64_t& first) noexcept;
+  void commit(uint64_t first, size_t count) noexcept;
+
+  std::string name;
+  void* region = nullptr;
+  size_t regionSize = 0;
+  bool owner = false;
+
+  // Read-only after construction, pointing into region
+  Header* header = nullptr;
+  std::byte* slots = nullptr;
+  size_t slotCount = 0;
+  uint64_t maxIndexMask = 0;
+};
+
+template <typename T>
+MPSCSharedQueue<T> MPSCSharedQueue<T>::create(const std::string& name,
+                                              size_t capacity) {
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    throw std::invalid_argument(
+        "MPSCSharedQueue algorithms are optimised for and intended to work "
+        "only with capacity of power of 2");
+  }
+
+  const size_t size = regionSizeFor(capacity);
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "shm_open " + name);
+  }
+
+  void* region = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+    region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  const int error = errno;
+  close(fd);
+
+  if (region == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    throw std::system_error(error, std::generic_category(), "mmap " + name);
+  }
+
+  auto* header = new (region) Header{};
+  header->layoutVersion = MPSC_SHARED_QUEUE_LAYOUT_VERSION;
+  header->slotSize = sizeof(T);
+  header->slotAlign = alignof(T);
+  header->slotCount = capacity;
+  header->magic.store(MAGIC, std::memory_order_release);
+
+  return MPSCSharedQueue(name, region, size, true);
+}
+
+template <typename T>
+MPSCSharedQueue<T> MPSCSharedQueue<T>::attach(const std::string& name) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "shm_open " + name);
+  }
+
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    const int error = errno;
+    close(fd);
+    throw std::system_error(error, std::generic_category(), "fstat " + name);
+  }
+
+  const auto size = static_cast<size_t>(st.st_size);
+  if (size < sizeof(Header)) {
+    // Creator has not sized the region yet
+    close(fd);
+    throw std::runtime_error(name + " is not an initialised MPSCSharedQueue");
+  }
+
+  void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int error = errno;
+  close(fd);
+  if (region == MAP_FAILED) {
+    throw std::system_error(error, std::generic_category(), "mmap " + name);
+  }
+
+  const auto* header = static_cast<const Header*>(region);
+  const char* mismatch = nullptr;
+
+  if (header->magic.load(std::memory_order_acquire) != MAGIC) {
+    mismatch = " is not an initialised MPSCSharedQueue";
+  } else if (header->layoutVersion != MPSC_SHARED_QUEUE_LAYOUT_VERSION) {
+    mismatch = " was created with another MPSCSharedQueue layout version";
+  } else if (header->slotSize != sizeof(T) || header->slotAlign != alignof(T)) {
+    mismatch = " holds a different message type";
+  } else if (const uint64_t count = header->slotCount;
+             count == 0 || (count & (count - 1)) != 0 ||
+             (size - sizeof(Header)) / sizeof(T) != count) {
+    mismatch = " has a size that does not match its capacity";
+  }
+
+  if (mismatch != nullptr) {
+    munmap(region, size);
+    throw std::runtime_error(name + mismatch);
+  }
+
+  return MPSCSharedQueue(name, region, size, false);
+}
+
+template <typename T>
+MPSCSharedQueue<T>::MPSCSharedQueue(const std::string& n, void* r,
+                                    size_t size, bool owns)
+    : name(n),
+      region(r),
+      regionSize(size),
+      owner(owns),
+      header(static_cast<Header*>(r)),
+      slots(static_cast<std::byte*>(r) + sizeof(Header)),
+      slotCount(header->slotCount),
+      maxIndexMask(header->slotCount - 1) {}
+
+template <typename T>
+MPSCSharedQueue<T>::MPSCSharedQueue(MPSCSharedQueue&& other) noexcept
+    : name(std::move(other.name)),
+      region(std::exchange(other.region, nullptr)),
+      regionSize(other.regionSize),
+      owner(std::exchange(other.owner, false)),
+      header(other.header),
+      slots(other.slots),
+      slotCount(other.slotCount),
+      maxIndexMask(other.maxIndexMask) {}
+
+template <typename T>
+MPSCSharedQueue<T>::~MPSCSharedQueue() {
+  if (region != nullptr) {
+    munmap(region, regionSize);
+  }
+  if (owner) {
+    shm_unlink(name.c_str());
+  }
+}
+
+template <typename T>
+bool MPSCSharedQueue<T>::reserve(size_t count, uint64_t& first) noexcept {
+  if (count > slotCount) {
+    return false;
+  }
+
+  uint64_t rw = header->reserveWriteIndex.load(std::memory_order_relaxed);
+  while (true) {
+    uint64_t r = header->readIndex.load(std::memory_order_acquire);
+
+    if (slotCount - (rw - r) < count) {
+      // Buffer is full, writer would lap the reader by full capacity
+      return false;
+    }
+
+    if (header->reserveWriteIndex.compare_exchange_weak(
+            rw, rw + count, std::memory_order_relaxed)) {
+      first = rw;
+      return true;
+    }
+  }
+}
+
+template <typename T>
+void MPSCSharedQueue<T>::commit(uint64_t first, size_t count) noexcept {
+  uint64_t expected = first;
+  while (!header->commitWriteIndex.compare_exchange_weak(
+      expected, first + count, std::memory_order_release,
+      std::memory_order_relaxed)) {
+    expected = first;
+    std::this_thread::yield();
+  }
+}
+
+template <typename T>
+bool MPSCSharedQueue<T>::push(const T& msg) noexcept {
+  uint64_t rw = 0;
+  if (!reserve(1, rw)) {
+    return false;
+  }
+
+  std::memcpy(slotAt(rw), &msg, sizeof(T));
+  commit(rw, 1);
+  return true;
+}
+
+template <typename T>
+bool MPSCSharedQueue<T>::try_push_n(std::span<const T> msgs) noexcept {
+  if (msgs.empty()) {
+    return true;
+  }
+
+  uint64_t rw = 0;
+  if (!reserve(msgs.size(), rw)) {
+    return false;
+  }
+
+  // At most two copies, the second one when the range wraps around
+  const size_t untilWrap = slotCount - (rw & maxIndexMask);
+  const size_t head = std::min(msgs.size(), untilWrap);
+  std::memcpy(slotAt(rw), msgs.data(), head * sizeof(T));
+  std::memcpy(slots, msgs.data() + head, (msgs.size() - head) * sizeof(T));
+
+  commit(rw, msgs.size());
+  return true;
+}
+
+template <typename T>
+std::optional<T> MPSCSharedQueue<T>::pop() noexcept {
+  uint64_t r = header->readIndex.load(std::memory_order_relaxed);
+  uint64_t cw = header->commitWriteIndex.load(std::memory_order_acquire);
+
+  if (cw == r) {
+    // buffer empty
+    return std::nullopt;
+  }
+
+  std::array<std::byte, sizeof(T)> bytes;
+  std::memcpy(bytes.data(), slotAt(r), sizeof(T));
+
+  header->readIndex.store(r + 1, std::memory_order_release);
+
+  return std::bit_cast<T>(bytes);
+}
+
+template <typename T>
+template <typename OutputIt>
+size_t MPSCSharedQueue<T>::pop_bulk(OutputIt out, size_t max) {
+  uint64_t r = header->readIndex.load(std::memory_order_relaxed);
+  uint64_t cw = header->commitWriteIndex.load(std::memory_order_acquire);
+
+  const auto count = static_cast<size_t>(std::min<uint64_t>(cw - r, max));
+  std::array<std::byte, sizeof(T)> bytes;
+  for (size_t i = 0; i < count; ++i) {
+    std::memcpy(bytes.data(), slotAt(r + i), sizeof(T));
+    *out++ = std::bit_cast<T>(bytes);
+  }
+
+  if (count != 0) {
+    header->readIndex.store(r + count, std::memory_order_release);
+  }
+  return count;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "SPSCQueue.hpp"
+
+// Multiple-producer, single-consumer queue sharded into one SPSC lane per
+// producer. Producers never share a write index: each registers once and
+// pushes into its own SPSCQueue, the consumer visits the lanes in turn.
+// Producer: registerProducer() once -> handle.push() per message
+// Consumer: pop() round-robin over lanes, or pop_bulk() draining lane by
+// lane
+//
+// Ordering is FIFO per producer only, there is no global order across
+// lanes. Lanes live as long as the queue, a handle must not outlive it and
+// must be used by one thread at a time. T must be default-constructible and
+// move-assignable, as the lanes are drained through SPSCQueue::pop(T&).
+
+template <typename T, size_t LaneSize = 1024, size_t MaxProducers = 64>
+class ShardedMPSC {
+ private:
+  using Lane = SPSCQueue<T, LaneSize>;
+
+ public:
+  // Registration handle, the only way to push into a lane
+  class Producer {
+   public:
+    [[nodiscard]] bool push(const T& msg) { return lane->push(msg); }
+
+   private:
+    friend class ShardedMPSC;
+    explicit Producer(Lane* l) : lane(l) {}
+
+    Lane* lane;
+  };
+
+  ShardedMPSC() = default;
+  ~ShardedMPSC();
+
+  ShardedMPSC(const ShardedMPSC&) = delete;
+  ShardedMPSC& operator=(const ShardedMPSC&) = delete;
+
+  // Claims a lane, throws std::length_error once MaxProducers registered
+  [[nodiscard]] Producer registerProducer();
+
+  // Takes one message, starting after the lane served last
+  [[nodiscard]] std::optional<T> pop();
+  // Drains lanes in turn into out, up to max messages, returns how many
+  template <typename OutputIt>
+  size_t pop_bulk(OutputIt out, size_t max);
+
+ private:
+  std::atomic<Lane*> lanes[MaxProducers] = {};
+  std::atomic<size_t> laneCount{0};
+
+  // Consumer only
+  size_t nextLane = 0;
+};
+
+template <typename T, size_t LaneSize, size_t MaxProducers>
+ShardedMPSC<T, LaneSize, MaxProducers>::~ShardedMPSC() {
+  for (auto& lane : lanes) {
+    delete lane.load(std::memory_order_relaxed);
+  }
+}
+
+template <typename T, size_t LaneSize, size_t MaxProducers>
+typename ShardedMPSC<T, LaneSize, MaxProducers>::Producer
+ShardedMPSC<T, LaneSize, MaxProducers>::registerProducer() {
+  size_t id = laneCount.fetch_add(1, std::memory_order_relaxed);
+  if (id >= MaxProducers) {
+    laneCount.fetch_sub(1, std::memory_order_relaxed);
+    throw std::length_error("ShardedMPSC has no free producer lane");
+  }
+
+  // Each lane is a separate allocation, producers write to disjoint memory
+  auto* lane = new Lane();
+  lanes[id].store(lane, std::memory_order_release);
+  return Producer(lane);
+}
+
+template <typename T, size_t LaneSize, size_t MaxProducers>
+std::optional<T> ShardedMPSC<T, LaneSize, MaxProducers>::pop() {
+  const size_t count =
+      std::min(laneCount.load(std::memory_order_acquire), MaxProducers);
+
+  T msg{};
+  for (size_t i = 0; i < count; ++i) {
+    size_t id = (nextLane + i) % count;
+    Lane* lane = lanes[id].load(std::memory_order_acquire);
+
+    // A null lane is registered but not published yet
+    if (lane != nullptr && lane->pop(msg)) {
+      nextLane = id + 1;
+      return msg;
+    }
+  }
+  return std::nullopt;
+}
+
+template <typename T, size_t LaneSize, size_t MaxProducers>
+template <typename OutputIt>
+size_t ShardedMPSC<T, LaneSize, MaxProducers>::pop_bulk(OutputIt out,
+                                                        size_t max) {
+  const size_t count =
+      std::min(laneCount.load(std::memory_order_acquire), MaxProducers);
+
+  size_t popped = 0;
+  T msg{};
+  for (size_t i = 0; i < count && popped < max; ++i) {
+    Lane* lane = lanes[(nextLane + i) % count].load(std::memory_order_acquire);
+    if (lane == nullptr) {
+      continue;
+    }
+
+    while (popped < max && lane->pop(msg)) {
+      *out++ = std::move(msg);
+      ++popped;
+    }
+  }
+
+  if (count != 0) {
+    nextLane = (nextLane + 1) % count;
+  }
+  return popped;
+}
@@ -1,15 +1,22 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <exception>
 #include <future>
+#include <iterator>
 #include <mutex>
 #include <optional>
 #include <queue>
 #include <stdexcept>
+#include <memory>
+#include <thread>
 #include <vector>
 
+#include "mpmc_ring.hpp"
 #include "selector.hpp"
 
 template <typename T>
@@ -23,8 +30,14 @@ class Channel {
    * Use Case: Create buffered or unbuffered channels for inter-thread
    * communication. Example: Channel<int> ch(5); // Creates a buffered channel
    * with capacity 5 Channel<std::string> ch; // Creates an unbuffered channel
+   *
+   * Buffered channels keep their values in a lock-free MPMCRing: send and
+   * receive take the mutex only to park on a full or empty ring, or to wake
+   * a parked counterpart or selector when there is one.
    */
-  Channel(size_t cap = 0) : capacity(cap) {}
+  Channel(size_t cap = 0)
+      : capacity(cap),
+        ring(cap != 0 ? std::make_unique<MPMCRing<T>>(cap) : nullptr) {}
 
   // Disable copying and moving
   Channel(const Channel&) = delete;
@@ -35,6 +48,11 @@ class Channel {
   // Destructor
   ~Channel() {
     close();  // Ensure the channel is closed before destruction
+    // Selectors that are still registered must forget the channel
+    std::unique_lock<std::mutex> lock(mtx);
+    for (const SelectorRegistration& entry : selectors) {
+      entry.selector->notify_detached(entry.id);
+    }
   }
 
   /**
@@ -56,6 +74,11 @@ class Channel {
    * Use Case: Send data without blocking the current thread.
    * Example: auto future = ch.async_send(42);
    *          future.wait(); // Wait for the send to complete if needed
+   *
+   * Completes the future at once if a buffered channel has space or a
+   * receiver waits. Otherwise the value waits in the channel and the
+   * receive that takes it completes the future, no thread waits for it.
+   * A close() before that completes it with std::runtime_error.
    */
   std::future<void> async_send(const T& value);
 
@@ -91,6 +114,10 @@ class Channel {
    * Use Case: Receive data without blocking the current thread.
    * Example: auto future = ch.async_receive();
    *          auto value = future.get();
+   *
+   * Completes the future at once if the channel holds a value or a sender
+   * waits. Otherwise the next send completes it directly, no thread waits
+   * for it, and a close() completes it with std::nullopt.
    */
   std::future<std::optional<T>> async_receive();
   /**
@@ -106,6 +133,45 @@ class Channel {
    */
   std::optional<T> try_receive();
 
+  /**
+   * @brief Sends the values in [first, last) in order. Blocks while the
+   * channel is full (buffered) or has no receiver (unbuffered).
+   * @param first The first value to send.
+   * @param last One past the last value to send.
+   * @throws std::runtime_error if the channel is closed, the values before
+   * the one that did not fit were sent.
+   *
+   * Use Case: Pass many small values with one wakeup instead of one each.
+   * Example: std::vector<int> batch{1, 2, 3};
+   *          ch.send_range(batch.begin(), batch.end());
+   *
+   * Buffered channels claim as many slots as fit with one ring operation,
+   * then wake receivers and notify selectors once for all of them.
+   */
+  template <std::forward_iterator It>
+  void send_range(It first, It last);
+
+  /**
+   * @brief Receives up to max values, waiting up to timeout for the first
+   * one.
+   * @param out Where the values are written.
+   * @param max The most values to receive.
+   * @param timeout How long to wait while the channel is empty.
+   * @return The number of values written to out, 0 if the timeout passed
+   * or the channel is closed and empty.
+   *
+   * Use Case: Drain a channel in batches.
+   * Example: std::vector<int> batch(64);
+   *          size_t count = ch.receive_up_to(batch.begin(), batch.size(),
+   *                                          std::chrono::milliseconds(10));
+   *
+   * Takes whatever is available up to max, it does not wait for more once
+   * it has a value. Wakes senders and notifies selectors once per batch.
+   */
+  template <typename OutputIt, typename Rep, typename Period>
+  size_t receive_up_to(OutputIt out, size_t max,
+                       std::chrono::duration<Rep, Period> timeout);
+
   /**
    * @brief Closes the channel. No more values can be sent after closing.
    *
@@ -124,10 +190,7 @@ class Channel {
    *  // Perform operations
    * }
    */
-  bool is_closed() const {
-    std::unique_lock<std::mutex> lock(mtx);
-    return closed;
-  }
+  bool is_closed() const { return closed.load(std::memory_order_acquire); }
 
   /**
    * @brief Checks if the channel is empty.
@@ -139,10 +202,7 @@ class Channel {
    *  auto value = ch.receive();
    * }
    */
-  bool is_empty() const {
-    std::unique_lock<std::mutex> lock(mtx);
-    return queue.empty();
-  }
+  bool is_empty() const { return size() == 0; }
 
   /**
    * @brief Returns the current number of items in the channel.
@@ -152,6 +212,9 @@ class Channel {
    * Example: std::cout << "Items in channel: " << ch.size() << "\n";
    */
   size_t size() const {
+    if (ring) {
+      return ring->size_approx();
+    }
     std::unique_lock<std::mutex> lock(mtx);
     return queue.size();
   }
@@ -161,31 +224,128 @@ class Channel {
    * @brief Registers a selector with the channel.
    *
    * @param selector The selector to register.
-   * @note This function is called by the Selector class and should not be
-   * called directly.
+   * @param id The selector's id for this channel, passed back to
+   * ReadyListener::notify_ready on the event or when the channel closes.
+   * @param event Receive to hear about new values, Send to hear about freed
+   * slots and waiting receivers.
+   * @note This function is called by the Selector and Select classes and
+   * should not be called directly.
    * @see Selector
    */
-  void register_selector(Selector* selector);
+  void register_selector(ReadyListener* selector, size_t id,
+                         ReadyEvent event = ReadyEvent::Receive);
 
   /**
-   * @brief Unregisters a selector from the channel.
+   * @brief Unregisters a selector from the channel, for all its ids.
    *
    * @param selector The selector to unregister.
    * @note This function is called by the Selector class and should not be
    * called directly.
    * @see Selector
    */
-  void unregister_selector(Selector* selector);
+  void unregister_selector(ReadyListener* selector);
+
+  /**
+   * @brief Counts an armed Select receive case as a waiting receiver of an
+   * unbuffered channel, so that a blocked sender hands its value over. Does
+   * nothing for buffered channels.
+   */
+  void offer_receive();
+
+  /**
+   * @brief Takes back an offer_receive(). A value handed over for it that
+   * the Select did not take stays for the next receiver.
+   */
+  void withdraw_receive();
+
+  /**
+   * @brief Sends a value if that does not block, for Select send cases.
+   * @return true if the value was sent.
+   * @throws std::runtime_error if the channel is closed.
+   *
+   * Unlike try_send, an unbuffered channel only takes the value when a
+   * receiver is waiting for it.
+   */
+  bool try_select_send(const T& value);
+
+  /**
+   * @brief Checks if an unbuffered channel has a receiver, blocked or
+   * pending, that no value was handed to yet. Called with mtx held.
+   */
+  bool receiver_waiting() const {
+    return waitingReceivers + pendingReceives.size() > queue.size();
+  }
+
+  /**
+   * @brief Moves pending async sends into freed slots and wakes parked
+   * senders and the send selectors after values were taken from the ring.
+   * Pairs with the parking side through seq_cst fences, so either the waker
+   * sees the counter or the parked thread sees the ring change.
+   */
+  void wake_senders(size_t values = 1);
 
+  /**
+   * @brief Hands new values to parked receivers and pending async receives,
+   * if there are any.
+   */
+  void wake_receivers(size_t values = 1);
+
+  /**
+   * @brief Completes what the pending async operations can complete now:
+   * receives from the channel or straight from a pending send, sends into
+   * the ring or to a waiting receiver, and all of them once the channel is
+   * closed. Called with mtx held.
+   */
+  void settle_pending();
+
+  /**
+   * @brief Notifies the selectors registered for the event, if any. Relies
+   * on a seq_cst fence after the ring change, like wake().
+   */
+  void notify_selectors(ReadyEvent event);
+  void notify_selectors_locked(ReadyEvent event);
+
+  struct PendingSend {
+    T value;
+    std::promise<void> sent;
+  };
+
+  // Unbuffered channels hand values over through the queue under mtx
   std::queue<T> queue;
   mutable std::mutex mtx;
   std::condition_variable cv_send, cv_recv;
-  bool closed = false;
+  std::atomic<bool> closed{false};
   size_t capacity;
+  // Receivers blocked in receive(), including those a value is queued for
   size_t waitingReceivers = 0;
 
+  // Buffered channels only
+  // Full or empty ring: yields before parking, so that a counterpart on the
+  // same core gets to run without a futex wait and wake
+  static constexpr int kYieldsBeforePark = 16;
+  std::unique_ptr<MPMCRing<T>> ring;
+  std::atomic<size_t> parkedSenders{0};
+  std::atomic<size_t> parkedReceivers{0};
+
+  // Async operations the counterpart completes, guarded by mtx. The counts
+  // let the lock-free paths skip the mutex when there are none
+  std::deque<std::promise<std::optional<T>>> pendingReceives;
+  std::atomic<size_t> pendingReceiveCount{0};
+  std::deque<PendingSend> pendingSends;
+  std::atomic<size_t> pendingSendCount{0};
+
   friend class Selector;
-  std::vector<Selector*> selectors;
+  friend class Select;
+  struct SelectorRegistration {
+    ReadyListener* selector;
+    size_t id;
+    ReadyEvent event;
+  };
+  std::vector<SelectorRegistration> selectors;
+  // Registrations per event, so sends and receives skip the mutex when
+  // nobody listens
+  std::atomic<size_t> receiveSelectorCount{0};
+  std::atomic<size_t> sendSelectorCount{0};
 };
 
 #include "channel.tpp"
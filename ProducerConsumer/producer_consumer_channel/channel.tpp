@@ -2,76 +2,222 @@
 
 template <typename T>
 void Channel<T>::send(const T& value) {
+  if (ring) {
+    if (closed.load(std::memory_order_acquire)) {
+      throw std::runtime_error("Send on closed channel");
+    }
+    bool sent = ring->try_emplace(value);
+    // Let a receiver on this core run before paying for a park and a wake
+    for (int i = 0; !sent && i < kYieldsBeforePark; ++i) {
+      std::this_thread::yield();
+      sent = ring->try_emplace(value);
+    }
+    if (!sent) {
+      // The ring is full, park until a receiver frees a slot
+      std::unique_lock<std::mutex> lock(mtx);
+      parkedSenders.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      cv_send.wait(lock, [this, &value, &sent] {
+        sent = !closed.load() && ring->try_emplace(value);
+        return sent || closed.load();
+      });
+      parkedSenders.fetch_sub(1);
+      if (!sent) {
+        throw std::runtime_error("Channel closed while waiting to send");
+      }
+    }
+    wake_receivers();
+    notify_selectors(ReadyEvent::Receive);
+    return;
+  }
+
   std::unique_lock<std::mutex> lock(mtx);
   if (closed) {
     throw std::runtime_error("Send on closed channel");
   }
-  if (capacity == 0) {
-    // For unbuffered channels, wait until there's a receiver or the channel
-    // is closed
-    cv_send.wait(lock, [this] { return waitingReceivers > 0 || closed; });
-    if (closed) {
-      throw std::runtime_error("Channel closed while waiting to send");
-    }
-    --waitingReceivers;
-    queue.push(value);
-    cv_recv.notify_one();  // Notify a waiting receiver
-    // Notify all registered selectors
-    for (auto selector : selectors) {
-      selector->notify();
-    }
-  } else {
-    // For buffered channels, wait until there's space in the buffer or the
-    // channel is closed
-    cv_send.wait(lock, [this] { return queue.size() < capacity || closed; });
-    if (closed) {
-      throw std::runtime_error("Channel closed while waiting to send");
-    }
-    queue.push(value);
-    cv_recv.notify_one();  // Notify a waiting receiver
-    // Notify all registered selectors
-    for (auto selector : selectors) {
-      selector->notify();
-    }
+  // For unbuffered channels, wait until there's a receiver without a value
+  // or the channel is closed
+  cv_send.wait(lock, [this] { return receiver_waiting() || closed; });
+  if (closed) {
+    throw std::runtime_error("Channel closed while waiting to send");
   }
+  queue.push(value);
+  settle_pending();      // The receiver may be a pending async receive
+  cv_recv.notify_one();  // Notify a waiting receiver
+  notify_selectors_locked(ReadyEvent::Receive);
 }
 
 template <typename T>
 std::future<void> Channel<T>::async_send(const T& value) {
-  // Launch an asynchronous task to send the value
-  return std::async(std::launch::async, [this, value] { this->send(value); });
+  std::promise<void> sent;
+  auto future = sent.get_future();
+  // Complete at once if the value fits, a pending receive gets it directly
+  if (ring && try_send(value)) {
+    sent.set_value();
+    return future;
+  }
+
+  // Leave the value for a receiver to take
+  std::unique_lock<std::mutex> lock(mtx);
+  if (closed) {
+    sent.set_exception(
+        std::make_exception_ptr(std::runtime_error("Send on closed channel")));
+    return future;
+  }
+  pendingSends.push_back({value, std::move(sent)});
+  pendingSendCount.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  // A receive may have missed the count, or a receiver may wait already
+  settle_pending();
+  if (!ring) {
+    // A Select receive case takes the value from a pending send
+    notify_selectors_locked(ReadyEvent::Receive);
+  }
+  return future;
 }
 
 template <typename T>
 bool Channel<T>::try_send(const T& value) {
+  if (ring) {
+    // If the channel is closed or the buffer is full, return false
+    if (closed.load(std::memory_order_acquire) || !ring->try_emplace(value)) {
+      return false;
+    }
+    wake_receivers();
+    notify_selectors(ReadyEvent::Receive);
+    return true;
+  }
+
   std::unique_lock<std::mutex> lock(mtx);
-  // If the channel is closed or the buffer is full, return false
-  if (closed || (capacity != 0 && queue.size() >= capacity)) {
+  if (closed) {
     return false;
   }
   queue.push(value);
+  settle_pending();
   cv_recv.notify_one();  // Notify a waiting receiver
-  // Notify all registered selectors
-  for (auto selector : selectors) {
-    selector->notify();
+  notify_selectors_locked(ReadyEvent::Receive);
+  return true;
+}
+
+template <typename T>
+bool Channel<T>::try_select_send(const T& value) {
+  if (ring) {
+    if (closed.load(std::memory_order_acquire)) {
+      throw std::runtime_error("Send on closed channel");
+    }
+    return try_send(value);
+  }
+
+  std::unique_lock<std::mutex> lock(mtx);
+  if (closed) {
+    throw std::runtime_error("Send on closed channel");
   }
+  if (!receiver_waiting()) {
+    return false;
+  }
+  queue.push(value);
+  settle_pending();
+  cv_recv.notify_one();  // Notify a waiting receiver
+  notify_selectors_locked(ReadyEvent::Receive);
   return true;
 }
 
 template <typename T>
-std::optional<T> Channel<T>::receive() {
+template <std::forward_iterator It>
+void Channel<T>::send_range(It first, It last) {
+  if (ring) {
+    while (first != last) {
+      if (closed.load(std::memory_order_acquire)) {
+        throw std::runtime_error("Send on closed channel");
+      }
+      size_t sent = ring->try_push_n(first, last);
+      for (int i = 0; sent == 0 && i < kYieldsBeforePark; ++i) {
+        std::this_thread::yield();
+        sent = ring->try_push_n(first, last);
+      }
+      if (sent == 0) {
+        // The ring is full, park until a receiver frees a slot
+        std::unique_lock<std::mutex> lock(mtx);
+        parkedSenders.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv_send.wait(lock, [this, &first, last, &sent] {
+          sent = closed.load() ? 0 : ring->try_push_n(first, last);
+          return sent != 0 || closed.load();
+        });
+        parkedSenders.fetch_sub(1);
+        if (sent == 0) {
+          throw std::runtime_error("Channel closed while waiting to send");
+        }
+      }
+      wake_receivers(sent);
+      notify_selectors(ReadyEvent::Receive);
+    }
+    return;
+  }
+
   std::unique_lock<std::mutex> lock(mtx);
-  if (capacity == 0) {
-    // For unbuffered channels, notify a sender and wait for a value
-    ++waitingReceivers;
-    cv_send.notify_one();
-    cv_recv.wait(lock, [this] { return !queue.empty() || closed; });
-    --waitingReceivers;
-  } else {
-    // For buffered channels, wait until there's a value or the channel is
-    // closed
-    cv_recv.wait(lock, [this] { return !queue.empty() || closed; });
+  while (first != last) {
+    if (closed) {
+      throw std::runtime_error("Send on closed channel");
+    }
+    cv_send.wait(lock, [this] { return receiver_waiting() || closed; });
+    if (closed) {
+      throw std::runtime_error("Channel closed while waiting to send");
+    }
+    // One value for every receiver that is waiting now
+    size_t sent = 0;
+    for (; first != last && receiver_waiting(); ++first, ++sent) {
+      queue.push(*first);
+    }
+    settle_pending();
+    if (sent == 1) {
+      cv_recv.notify_one();
+    } else {
+      cv_recv.notify_all();
+    }
+    notify_selectors_locked(ReadyEvent::Receive);
   }
+}
+
+template <typename T>
+std::optional<T> Channel<T>::receive() {
+  if (ring) {
+    std::optional<T> value = ring->try_pop();
+    for (int i = 0; !value && i < kYieldsBeforePark; ++i) {
+      std::this_thread::yield();
+      if (auto popped = ring->try_pop()) {
+        value.emplace(std::move(*popped));
+      }
+    }
+    if (!value) {
+      // The ring is empty, park until a sender publishes a value or the
+      // channel is closed
+      std::unique_lock<std::mutex> lock(mtx);
+      parkedReceivers.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      cv_recv.wait(lock, [this, &value] {
+        if (auto popped = ring->try_pop()) {
+          value.emplace(std::move(*popped));
+          return true;
+        }
+        return closed.load();
+      });
+      parkedReceivers.fetch_sub(1);
+    }
+    if (value) {
+      wake_senders();
+    }
+    return value;
+  }
+
+  std::unique_lock<std::mutex> lock(mtx);
+  // For unbuffered channels, notify a sender and wait for a value
+  ++waitingReceivers;
+  settle_pending();  // A pending async send hands its value over
+  cv_send.notify_one();
+  notify_selectors_locked(ReadyEvent::Send);
+  cv_recv.wait(lock, [this] { return !queue.empty() || closed; });
+  --waitingReceivers;
   if (queue.empty() && closed) {
     return std::nullopt;  // Return empty optional if channel is closed and
                           // empty
@@ -84,15 +230,52 @@ std::optional<T> Channel<T>::receive() {
 
 template <typename T>
 std::future<std::optional<T>> Channel<T>::async_receive() {
-  // Launch an asynchronous task to receive a value
-  return std::async(std::launch::async, [this] { return this->receive(); });
+  std::promise<std::optional<T>> received;
+  auto future = received.get_future();
+  if (ring) {
+    if (auto value = try_receive()) {
+      received.set_value(std::move(value));
+      return future;
+    }
+  }
+
+  // Leave the promise for the next send to complete
+  std::unique_lock<std::mutex> lock(mtx);
+  pendingReceives.push_back(std::move(received));
+  pendingReceiveCount.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  // A send may have missed the count, a sender may wait already or the
+  // channel may be closed
+  settle_pending();
+  if (!ring) {
+    // A blocked sender or a Select send case now has a receiver
+    cv_send.notify_one();
+    notify_selectors_locked(ReadyEvent::Send);
+  }
+  return future;
 }
 
 template <typename T>
 std::optional<T> Channel<T>::try_receive() {
+  if (ring) {
+    std::optional<T> value = ring->try_pop();
+    if (value) {
+      wake_senders();
+    }
+    return value;
+  }
+
   std::unique_lock<std::mutex> lock(mtx);
   if (queue.empty()) {
-    return std::nullopt;  // Return empty optional if queue is empty
+    if (pendingSends.empty()) {
+      return std::nullopt;  // Return empty optional if queue is empty
+    }
+    // Take the value of a pending async send
+    T value = std::move(pendingSends.front().value);
+    pendingSends.front().sent.set_value();
+    pendingSends.pop_front();
+    pendingSendCount.fetch_sub(1);
+    return value;
   }
   T value = queue.front();
   queue.pop();
@@ -100,28 +283,227 @@ std::optional<T> Channel<T>::try_receive() {
   return value;
 }
 
+template <typename T>
+template <typename OutputIt, typename Rep, typename Period>
+size_t Channel<T>::receive_up_to(OutputIt out, size_t max,
+                                 std::chrono::duration<Rep, Period> timeout) {
+  if (max == 0) {
+    return 0;
+  }
+  // Only read the clock when it comes to waiting
+  auto deadline = [&timeout] {
+    return std::chrono::steady_clock::now() +
+           std::chrono::ceil<std::chrono::steady_clock::duration>(timeout);
+  };
+
+  if (ring) {
+    size_t received = ring->try_pop_n(out, max);
+    for (int i = 0; received == 0 && i < kYieldsBeforePark; ++i) {
+      std::this_thread::yield();
+      received = ring->try_pop_n(out, max);
+    }
+    if (received == 0) {
+      // The ring is empty, park until a sender publishes values, the
+      // channel is closed or the timeout passes
+      std::unique_lock<std::mutex> lock(mtx);
+      parkedReceivers.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      cv_recv.wait_until(lock, deadline(), [this, &out, max, &received] {
+        received = ring->try_pop_n(out, max);
+        return received != 0 || closed.load();
+      });
+      parkedReceivers.fetch_sub(1);
+    }
+    if (received != 0) {
+      wake_senders(received);
+    }
+    return received;
+  }
+
+  std::unique_lock<std::mutex> lock(mtx);
+  // For unbuffered channels, notify a sender and wait for values
+  ++waitingReceivers;
+  settle_pending();  // A pending async send hands its value over
+  cv_send.notify_one();
+  notify_selectors_locked(ReadyEvent::Send);
+  cv_recv.wait_until(lock, deadline(),
+                     [this] { return !queue.empty() || closed; });
+  --waitingReceivers;
+  size_t received = 0;
+  for (; received < max && !queue.empty(); ++received, ++out) {
+    *out = std::move(queue.front());
+    queue.pop();
+  }
+  if (received != 0) {
+    cv_send.notify_one();  // Notify a waiting sender
+  }
+  return received;
+}
+
 template <typename T>
 void Channel<T>::close() {
   std::unique_lock<std::mutex> lock(mtx);
   closed = true;
+  settle_pending();
   cv_send.notify_all();  // Notify all waiting senders
   cv_recv.notify_all();  // Notify all waiting receivers
-  // Notify all registered selectors
-  for (auto selector : selectors) {
-    selector->notify();
+  notify_selectors_locked(ReadyEvent::Receive);
+  notify_selectors_locked(ReadyEvent::Send);
+}
+
+template <typename T>
+void Channel<T>::offer_receive() {
+  if (ring) {
+    return;
   }
+  std::unique_lock<std::mutex> lock(mtx);
+  ++waitingReceivers;
+  settle_pending();  // A pending async send hands its value over
+  cv_send.notify_one();
+  notify_selectors_locked(ReadyEvent::Send);
+}
+
+template <typename T>
+void Channel<T>::withdraw_receive() {
+  if (ring) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mtx);
+  --waitingReceivers;
 }
 
 template <typename T>
-void Channel<T>::register_selector(Selector* selector) {
+void Channel<T>::register_selector(ReadyListener* selector, size_t id,
+                                   ReadyEvent event) {
   std::unique_lock<std::mutex> lock(mtx);
-  selectors.push_back(selector);
+  selectors.push_back({selector, id, event});
+  auto& count = event == ReadyEvent::Receive ? receiveSelectorCount
+                                             : sendSelectorCount;
+  count.fetch_add(1);
 }
 
 template <typename T>
-void Channel<T>::unregister_selector(Selector* selector) {
+void Channel<T>::unregister_selector(ReadyListener* selector) {
   std::unique_lock<std::mutex> lock(mtx);
   // Remove the selector from the list
-  selectors.erase(std::remove(selectors.begin(), selectors.end(), selector),
-                  selectors.end());
+  std::erase_if(selectors,
+                [this, selector](const SelectorRegistration& entry) {
+                  if (entry.selector != selector) {
+                    return false;
+                  }
+                  auto& count = entry.event == ReadyEvent::Receive
+                                    ? receiveSelectorCount
+                                    : sendSelectorCount;
+                  count.fetch_sub(1);
+                  return true;
+                });
+}
+
+template <typename T>
+void Channel<T>::wake_senders(size_t values) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (parkedSenders.load(std::memory_order_relaxed) != 0 ||
+      pendingSendCount.load(std::memory_order_relaxed) != 0) {
+    // Under the mutex, so the notify can not slip in between the parked
+    // thread's check and its wait
+    std::unique_lock<std::mutex> lock(mtx);
+    settle_pending();
+    if (parkedSenders.load(std::memory_order_relaxed) != 0) {
+      if (values == 1) {
+        cv_send.notify_one();
+      } else {
+        cv_send.notify_all();
+      }
+    }
+  }
+  notify_selectors(ReadyEvent::Send);
+}
+
+template <typename T>
+void Channel<T>::wake_receivers(size_t values) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (parkedReceivers.load(std::memory_order_relaxed) != 0 ||
+      pendingReceiveCount.load(std::memory_order_relaxed) != 0) {
+    std::unique_lock<std::mutex> lock(mtx);
+    settle_pending();
+    if (parkedReceivers.load(std::memory_order_relaxed) != 0) {
+      if (values == 1) {
+        cv_recv.notify_one();
+      } else {
+        cv_recv.notify_all();
+      }
+    }
+  }
+}
+
+template <typename T>
+void Channel<T>::settle_pending() {
+  // Receives first, the values already in the channel are older than those
+  // of pending sends
+  while (!pendingReceives.empty()) {
+    std::optional<T> value;
+    if (ring) {
+      value = ring->try_pop();
+      if (value) {
+        // A slot was freed
+        if (parkedSenders.load() != 0) {
+          cv_send.notify_one();
+        }
+        notify_selectors_locked(ReadyEvent::Send);
+      }
+    } else if (!queue.empty()) {
+      value.emplace(std::move(queue.front()));
+      queue.pop();
+    }
+    if (!value && !pendingSends.empty()) {
+      value.emplace(std::move(pendingSends.front().value));
+      pendingSends.front().sent.set_value();
+      pendingSends.pop_front();
+      pendingSendCount.fetch_sub(1);
+    }
+    if (!value && !closed) {
+      break;
+    }
+    pendingReceives.front().set_value(std::move(value));
+    pendingReceives.pop_front();
+    pendingReceiveCount.fetch_sub(1);
+  }
+
+  while (!pendingSends.empty()) {
+    PendingSend& pending = pendingSends.front();
+    if (closed) {
+      pending.sent.set_exception(std::make_exception_ptr(
+          std::runtime_error("Channel closed while waiting to send")));
+    } else if (ring ? ring->try_emplace(pending.value) : receiver_waiting()) {
+      if (!ring) {
+        queue.push(std::move(pending.value));
+      }
+      pending.sent.set_value();
+      cv_recv.notify_one();
+      notify_selectors_locked(ReadyEvent::Receive);
+    } else {
+      break;
+    }
+    pendingSends.pop_front();
+    pendingSendCount.fetch_sub(1);
+  }
+}
+
+template <typename T>
+void Channel<T>::notify_selectors(ReadyEvent event) {
+  auto& count = event == ReadyEvent::Receive ? receiveSelectorCount
+                                             : sendSelectorCount;
+  if (count.load(std::memory_order_relaxed) != 0) {
+    std::unique_lock<std::mutex> lock(mtx);
+    notify_selectors_locked(event);
+  }
+}
+
+template <typename T>
+void Channel<T>::notify_selectors_locked(ReadyEvent event) {
+  for (const SelectorRegistration& entry : selectors) {
+    if (entry.event == event) {
+      entry.selector->notify_ready(entry.id);
+    }
+  }
 }
\ No newline at end of file
@@ -1,10 +1,21 @@
 // https://jyotinder.substack.com/p/implementing-go-channels-in-cpp
 // https://github.com/JyotinderSingh/CppChan/
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <queue>
 #include <thread>
+#include <vector>
 
 #include "channel.hpp"
+#include "select.hpp"
 
 constexpr int kMaxMessagesCount = 10;
 
@@ -63,7 +74,323 @@ void consumer() {
   }
 }
 
-int main() {
+// The buffered Channel before MPMCRing: mutex, std::queue and two condition
+// variables notified on every operation. Baseline for the benchmark only.
+template <typename T>
+class MutexChannel {
+ public:
+  explicit MutexChannel(size_t cap) : capacity(cap) {}
+
+  void send(const T& value) {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv_send.wait(lock, [this] { return queue.size() < capacity || closed; });
+    if (closed) {
+      throw std::runtime_error("Channel closed while waiting to send");
+    }
+    queue.push(value);
+    cv_recv.notify_one();
+  }
+
+  std::optional<T> receive() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv_recv.wait(lock, [this] { return !queue.empty() || closed; });
+    if (queue.empty()) {
+      return std::nullopt;
+    }
+    T value = queue.front();
+    queue.pop();
+    cv_send.notify_one();
+    return value;
+  }
+
+  void close() {
+    std::unique_lock<std::mutex> lock(mtx);
+    closed = true;
+    cv_send.notify_all();
+    cv_recv.notify_all();
+  }
+
+ private:
+  std::queue<T> queue;
+  std::mutex mtx;
+  std::condition_variable cv_send, cv_recv;
+  bool closed = false;
+  size_t capacity;
+};
+
+constexpr uint64_t kBenchItems = 1'000'000;
+constexpr size_t kBenchCapacity = 1024;
+
+// Items per microsecond through a buffered channel with the given number of
+// producer and consumer threads
+template <typename ChannelType>
+double measure_channel(unsigned producers, unsigned consumers) {
+  ChannelType channel(kBenchCapacity);
+  std::atomic<uint64_t> sum{0};
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> receivers;
+    for (unsigned c = 0; c < consumers; ++c) {
+      receivers.emplace_back([&channel, &sum] {
+        uint64_t local = 0;
+        while (auto value = channel.receive()) {
+          local += *value;
+        }
+        sum += local;
+      });
+    }
+
+    {
+      std::vector<std::jthread> senders;
+      for (unsigned p = 0; p < producers; ++p) {
+        senders.emplace_back([&channel, p, producers] {
+          for (uint64_t i = p; i < kBenchItems; i += producers) {
+            channel.send(i);
+          }
+        });
+      }
+    }
+    channel.close();
+  }
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (sum != kBenchItems * (kBenchItems - 1) / 2) {
+    std::cout << "Lost items\n";
+  }
+  return kBenchItems / elapsed.count();
+}
+
+void benchmark_buffered_channels() {
+  const std::pair<unsigned, unsigned> ratios[] = {{1, 1}, {4, 1}, {1, 4}};
+  std::cout << "producers:consumers  mutex + queue  lock-free ring"
+               "  (items/us)\n";
+  for (auto [producers, consumers] : ratios) {
+    double mutex_rate =
+        measure_channel<MutexChannel<uint64_t>>(producers, consumers);
+    double ring_rate = measure_channel<Channel<uint64_t>>(producers, consumers);
+    std::cout << "  " << producers << ":" << consumers << "               "
+              << mutex_rate << "\t\t" << ring_rate << '\n';
+  }
+}
+
+// Items per microsecond from one producer to one consumer that move
+// batch_size values per send_range and receive_up_to call. A registered
+// selector makes every batch take the channel mutex to notify it
+double measure_batches(size_t batch_size, bool with_selector) {
+  Channel<uint64_t> channel(kBenchCapacity);
+  Selector selector;
+  if (with_selector) {
+    selector.add_receive<uint64_t>(channel, [](uint64_t) {});
+  }
+  uint64_t sum = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::jthread receiver([&channel, &sum, batch_size] {
+      std::vector<uint64_t> batch(batch_size);
+      while (size_t count = channel.receive_up_to(
+                 batch.begin(), batch.size(), std::chrono::seconds(1))) {
+        sum = std::accumulate(batch.begin(), batch.begin() + count, sum);
+      }
+    });
+
+    std::vector<uint64_t> batch(batch_size);
+    for (uint64_t i = 0; i < kBenchItems; i += batch_size) {
+      size_t size = std::min<uint64_t>(batch_size, kBenchItems - i);
+      std::iota(batch.begin(), batch.begin() + size, i);
+      channel.send_range(batch.begin(), batch.begin() + size);
+    }
+    channel.close();
+  }
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (sum != kBenchItems * (kBenchItems - 1) / 2) {
+    std::cout << "Lost items\n";
+  }
+  return kBenchItems / elapsed.count();
+}
+
+void benchmark_batches() {
+  std::cout << "batch size  plain  with a selector  (items/us)\n";
+  for (size_t batch_size : {1, 16, 64, 256}) {
+    std::cout << "  " << batch_size << "\t\t"
+              << measure_batches(batch_size, false) << "\t"
+              << measure_batches(batch_size, true) << '\n';
+  }
+}
+
+constexpr unsigned kAsyncBursts = 80;
+constexpr unsigned kAsyncBurst = 256;
+
+// Async operations per millisecond: bursts of async_receive followed by as
+// many async_send (receives wait for the sends), then bursts of async_send
+// followed by async_receive (sends beyond the capacity wait for receives).
+// With StdAsync every call starts a thread, as Channel did before pending
+// operations were completed by their counterparts.
+template <bool StdAsync>
+double measure_async(size_t capacity) {
+  Channel<uint64_t> channel(capacity);
+  uint64_t sum = 0;
+
+  auto send = [&channel](uint64_t value) {
+    if constexpr (StdAsync) {
+      return std::async(std::launch::async,
+                        [&channel, value] { channel.send(value); });
+    } else {
+      return channel.async_send(value);
+    }
+  };
+  auto receive = [&channel] {
+    if constexpr (StdAsync) {
+      return std::async(std::launch::async,
+                        [&channel] { return channel.receive(); });
+    } else {
+      return channel.async_receive();
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  const uint64_t items = kAsyncBursts * kAsyncBurst;
+  for (unsigned done = 0; done < items; done += kAsyncBurst) {
+    std::vector<std::future<void>> sends;
+    std::vector<std::future<std::optional<uint64_t>>> receives;
+    const bool receivesFirst = done / kAsyncBurst % 2 == 0;
+    for (unsigned i = 0; i < kAsyncBurst; ++i) {
+      if (receivesFirst) {
+        receives.push_back(receive());
+      } else {
+        sends.push_back(send(done + i));
+      }
+    }
+    for (unsigned i = 0; i < kAsyncBurst; ++i) {
+      if (receivesFirst) {
+        sends.push_back(send(done + i));
+      } else {
+        receives.push_back(receive());
+      }
+    }
+    for (auto& sent : sends) {
+      sent.get();
+    }
+    for (auto& received : receives) {
+      sum += received.get().value_or(0);
+    }
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (sum != items * (items - 1) / 2) {
+    std::cout << "Lost items\n";
+  }
+  return 2 * items / elapsed.count();
+}
+
+void benchmark_async() {
+  std::cout << "async operations/ms    std::async  pending promises\n";
+  for (size_t capacity : {64, 0}) {
+    const char* label =
+        capacity != 0 ? "  buffered (64)        " : "  unbuffered           ";
+    std::cout << label << measure_async<true>(capacity) << "\t\t"
+              << measure_async<false>(capacity) << '\n';
+  }
+}
+
+constexpr unsigned kSelectorMessages = 20'000;
+
+// Messages per millisecond through one Selector over channels_count buffered
+// channels, a producer sending on one of them while the others stay idle
+double measure_selector(size_t channels_count) {
+  std::vector<std::unique_ptr<Channel<uint64_t>>> channels;
+  Selector selector;
+  std::atomic<unsigned> received{0};
+  for (size_t i = 0; i < channels_count; ++i) {
+    channels.push_back(std::make_unique<Channel<uint64_t>>(64));
+    selector.add_receive<uint64_t>(
+        *channels.back(), [&received](uint64_t) { ++received; });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::jthread select_thread([&selector] { selector.select(); });
+    for (unsigned i = 0; i < kSelectorMessages; ++i) {
+      channels.back()->send(i);
+    }
+    while (received.load() < kSelectorMessages) {
+      std::this_thread::yield();
+    }
+    selector.stop();
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return kSelectorMessages / elapsed.count();
+}
+
+void benchmark_selector() {
+  std::cout << "selector messages/ms by channel count:";
+  for (size_t channels_count : {1, 10, 100, 1000}) {
+    std::cout << "  " << channels_count << ": "
+              << measure_selector(channels_count);
+  }
+  std::cout << '\n';
+}
+
+constexpr unsigned kSelectRounds = 2'000;
+
+// Median time from send() to the callback of a Select blocked on the sent
+// channel and channels_count - 1 idle ones, in microseconds
+double measure_select_latency(size_t channels_count) {
+  std::vector<std::unique_ptr<Channel<int64_t>>> channels;
+  for (size_t i = 0; i < channels_count; ++i) {
+    channels.push_back(std::make_unique<Channel<int64_t>>(1));
+  }
+  auto now_ns = [] {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  };
+
+  std::vector<double> latencies;
+  latencies.reserve(kSelectRounds);
+  std::atomic<unsigned> handled{0};
+  {
+    std::jthread select_thread([&] {
+      Select select;
+      for (auto& ch : channels) {
+        select.on_receive<int64_t>(
+            *ch, [&](std::optional<int64_t> sent_ns) {
+              latencies.push_back((now_ns() - *sent_ns) / 1000.0);
+            });
+      }
+      for (unsigned i = 0; i < kSelectRounds; ++i) {
+        select.wait();
+        handled.store(i + 1);
+      }
+    });
+    for (unsigned i = 0; i < kSelectRounds; ++i) {
+      channels.back()->send(now_ns());
+      while (handled.load() <= i) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  std::nth_element(latencies.begin(),
+                   latencies.begin() + latencies.size() / 2, latencies.end());
+  return latencies[latencies.size() / 2];
+}
+
+void benchmark_select() {
+  std::cout << "select wake latency us (median) by channel count:";
+  for (size_t channels_count : {1, 10, 100}) {
+    std::cout << "  " << channels_count << ": "
+              << measure_select_latency(channels_count);
+  }
+  std::cout << '\n';
+}
+
+void demo() {
   std::jthread t1{producer};
   std::jthread t2{consumer};
   std::jthread t3{producer};
@@ -76,6 +403,16 @@ int main() {
     std::cout << "Close channel\n";
     buffer.close();
   }
+}
+
+int main() {
+  demo();
+
+  benchmark_buffered_channels();
+  benchmark_batches();
+  benchmark_async();
+  benchmark_selector();
+  benchmark_select();
 
   return 0;
 }
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Bounded lock-free multi-producer multi-consumer ring.
+ *
+ * Dmitry Vyukov's bounded queue:
+ * https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ *
+ * Every slot carries a sequence stamp. For position pos the stamp is 2 * pos
+ * when the slot is free, 2 * pos + 1 when it holds a value and
+ * 2 * (pos + capacity) once the value was taken. The factor 2 keeps a full
+ * slot apart from a free one of the next lap when the capacity is 1.
+ * Producers and consumers claim positions with a CAS on their own index and
+ * then publish the slot with a release store on the stamp, so nobody waits
+ * for a slower thread to finish its slot.
+ *
+ * Used by Channel as the buffer of buffered channels.
+ */
+template <typename T>
+class MPMCRing {
+ public:
+  /**
+   * @brief Constructs a ring holding up to capacity values.
+   * @param capacity The number of slots, at least 1.
+   */
+  explicit MPMCRing(size_t capacity)
+      : slotCount(capacity), slots(std::make_unique<Slot[]>(capacity)) {
+    for (size_t i = 0; i < slotCount; ++i) {
+      slots[i].sequence.store(2 * i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MPMCRing() {
+    while (try_pop()) {
+    }
+  }
+
+  MPMCRing(const MPMCRing&) = delete;
+  MPMCRing& operator=(const MPMCRing&) = delete;
+
+  /**
+   * @brief Constructs a value in the next free slot.
+   * @return false if the ring is full.
+   */
+  template <typename... Args>
+  bool try_emplace(Args&&... args) {
+    size_t pos = writeIndex.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots[pos % slotCount];
+      const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(sequence - 2 * pos);
+      if (diff == 0) {
+        if (writeIndex.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+          std::construct_at(slot.raw(), std::forward<Args>(args)...);
+          slot.sequence.store(2 * pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // The slot still holds a value from the last lap
+      } else {
+        pos = writeIndex.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Takes the oldest value.
+   * @return The value, or std::nullopt if the ring is empty.
+   */
+  std::optional<T> try_pop() {
+    size_t pos = readIndex.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots[pos % slotCount];
+      const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(sequence - (2 * pos + 1));
+      if (diff == 0) {
+        if (readIndex.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+          std::optional<T> value(std::move(*slot.data()));
+          std::destroy_at(slot.data());
+          slot.sequence.store(2 * (pos + slotCount),
+                              std::memory_order_release);
+          return value;
+        }
+      } else if (diff < 0) {
+        return std::nullopt;  // The slot was not published yet
+      } else {
+        pos = readIndex.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Copies values from [first, last) into consecutive free slots,
+   * claiming all of them with one CAS.
+   * @return The number of values pushed, first is advanced past them. 0 if
+   * the ring is full.
+   */
+  template <std::forward_iterator It>
+  size_t try_push_n(It& first, It last) {
+    const size_t wanted =
+        std::min<size_t>(std::distance(first, last), slotCount);
+    if (wanted == 0) {
+      return 0;
+    }
+    size_t pos = writeIndex.load(std::memory_order_relaxed);
+    for (;;) {
+      size_t count = 0;
+      while (count < wanted && sequence_at(pos + count) == 2 * (pos + count)) {
+        ++count;
+      }
+      if (count == 0) {
+        const auto diff =
+            static_cast<std::ptrdiff_t>(sequence_at(pos) - 2 * pos);
+        if (diff < 0) {
+          return 0;  // The slot still holds a value from the last lap
+        }
+        pos = writeIndex.load(std::memory_order_relaxed);
+        continue;
+      }
+      // Fails if another producer claimed pos meanwhile, so the checked
+      // slots are ours
+      if (writeIndex.compare_exchange_weak(pos, pos + count,
+                                           std::memory_order_relaxed)) {
+        for (size_t i = 0; i < count; ++i, ++first) {
+          Slot& slot = slots[(pos + i) % slotCount];
+          std::construct_at(slot.raw(), *first);
+          slot.sequence.store(2 * (pos + i) + 1, std::memory_order_release);
+        }
+        return count;
+      }
+    }
+  }
+
+  /**
+   * @brief Moves up to max of the oldest values to out, claiming them with
+   * one CAS.
+   * @return The number of values taken, out is advanced past them. 0 if the
+   * ring is empty.
+   */
+  template <typename OutputIt>
+  size_t try_pop_n(OutputIt& out, size_t max) {
+    const size_t wanted = std::min(max, slotCount);
+    if (wanted == 0) {
+      return 0;
+    }
+    size_t pos = readIndex.load(std::memory_order_relaxed);
+    for (;;) {
+      size_t count = 0;
+      while (count < wanted &&
+             sequence_at(pos + count) == 2 * (pos + count) + 1) {
+        ++count;
+      }
+      if (count == 0) {
+        const auto diff =
+            static_cast<std::ptrdiff_t>(sequence_at(pos) - (2 * pos + 1));
+        if (diff < 0) {
+          return 0;  // The slot was not published yet
+        }
+        pos = readIndex.load(std::memory_order_relaxed);
+        continue;
+      }
+      if (readIndex.compare_exchange_weak(pos, pos + count,
+                                          std::memory_order_relaxed)) {
+        for (size_t i = 0; i < count; ++i, ++out) {
+          Slot& slot = slots[(pos + i) % slotCount];
+          *out = std::move(*slot.data());
+          std::destroy_at(slot.data());
+          slot.sequence.store(2 * (pos + i + slotCount),
+                              std::memory_order_release);
+        }
+        return count;
+      }
+    }
+  }
+
+  /**
+   * @brief The number of values, only an estimate while other threads run.
+   */
+  size_t size_approx() const {
+    // readIndex first, writeIndex can only be ahead of it
+    const size_t read = readIndex.load(std::memory_order_acquire);
+    const size_t write = writeIndex.load(std::memory_order_acquire);
+    return write > read ? write - read : 0;
+  }
+
+  size_t capacity() const { return slotCount; }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    alignas(T) std::byte storage[sizeof(T)];
+
+    T* raw() { return reinterpret_cast<T*>(storage); }
+    T* data() { return std::launder(raw()); }
+  };
+
+  size_t sequence_at(size_t pos) const {
+    return slots[pos % slotCount].sequence.load(std::memory_order_acquire);
+  }
+
+  const size_t slotCount;
+  const std::unique_ptr<Slot[]> slots;
+
+  alignas(kCacheLineSize) std::atomic<size_t> writeIndex{0};
+  alignas(kCacheLineSize) std::atomic<size_t> readIndex{0};
+};
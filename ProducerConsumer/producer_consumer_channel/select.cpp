@@ -0,0 +1,111 @@
+#include "select.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <random>
+
+Select& Select::on_default(std::function<void()> callback) {
+  default_callback = std::move(callback);
+  has_default = true;
+  return *this;
+}
+
+void Select::notify_ready(size_t id) {
+  std::unique_lock<std::mutex> lock(mtx);
+  if (id < queued.size() && !queued[id]) {
+    queued[id] = true;
+    ready.push_back(id);
+    cv.notify_one();
+  }
+}
+
+size_t Select::run(
+    std::optional<std::chrono::steady_clock::time_point> deadline) {
+  std::vector<size_t> ids(cases.size());
+  std::iota(ids.begin(), ids.end(), 0);
+  std::optional<size_t> fired = try_cases(ids);
+
+  if (!fired && has_default) {
+    if (default_callback) {
+      default_callback();
+    }
+    return kDefault;
+  }
+  if (!fired) {
+    fired = wait_ready(deadline);
+  }
+  if (!fired) {
+    return kTimedOut;
+  }
+  // After wait_ready unregistered, so a slow callback does not keep the
+  // channels notifying
+  cases[*fired]->run_callback();
+  return *fired;
+}
+
+std::optional<size_t> Select::wait_ready(
+    std::optional<std::chrono::steady_clock::time_point> deadline) {
+  if (deadline && std::chrono::steady_clock::now() >= *deadline) {
+    return std::nullopt;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    ready.clear();
+    queued.assign(cases.size(), false);
+  }
+
+  // Unregisters on every way out, also when a send case throws
+  struct Disarm {
+    Select& select;
+    size_t armed = 0;
+    ~Disarm() {
+      for (size_t id = 0; id < armed; ++id) {
+        select.cases[id]->disarm(&select);
+      }
+    }
+  } disarm{*this};
+
+  // Outside mtx: the channels call notify_ready with their own mutex held
+  for (; disarm.armed < cases.size(); ++disarm.armed) {
+    cases[disarm.armed]->arm(this, disarm.armed);
+  }
+  // Pairs with the fence before a channel reads its selector count: either
+  // the channel saw the registration or the retry below sees the change
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  std::vector<size_t> ids(cases.size());
+  std::iota(ids.begin(), ids.end(), 0);
+  std::optional<size_t> fired = try_cases(ids);
+  while (!fired) {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      auto has_ready = [this] { return !ready.empty(); };
+      if (!deadline) {
+        cv.wait(lock, has_ready);
+      } else if (!cv.wait_until(lock, *deadline, has_ready)) {
+        return std::nullopt;
+      }
+      ids.swap(ready);
+      ready.clear();
+      // A change from now on queues the case again
+      for (size_t id : ids) {
+        queued[id] = false;
+      }
+    }
+    fired = try_cases(ids);
+  }
+  return fired;
+}
+
+std::optional<size_t> Select::try_cases(std::vector<size_t>& ids) {
+  // Per thread, so concurrent selects do not share the engine
+  thread_local std::minstd_rand engine{std::random_device{}()};
+  std::shuffle(ids.begin(), ids.end(), engine);
+  for (size_t id : ids) {
+    if (cases[id]->try_fire()) {
+      return id;
+    }
+  }
+  return std::nullopt;
+}
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "channel.hpp"
+
+/**
+ * @brief A one-shot select over send and receive cases, like Go's select
+ * statement.
+ *
+ * wait() fires exactly one ready case and returns its index, counting the
+ * cases in the order they were added. When several cases are ready it picks
+ * one at random, so a busy channel can not starve the others. With a
+ * default case wait() never blocks, and wait_for / wait_until give up at a
+ * deadline.
+ *
+ * While it blocks, wait() registers with every channel of its cases through
+ * Channel::register_selector and only retries the cases whose channels
+ * reported a change. A Select can be waited on again, each wait fires at
+ * most one case.
+ *
+ * Use Case: A pipeline stage that forwards values and also listens for a
+ * shutdown channel.
+ * Example:
+ * Select select;
+ * select.on_receive<int>(input, [](std::optional<int> value) { ... })
+ *     .on_receive<bool>(done, [](std::optional<bool>) { ... });
+ * if (select.wait_for(std::chrono::milliseconds(10)) == Select::kTimedOut) {
+ *   ...
+ * }
+ */
+class Select : public ReadyListener {
+ public:
+  // Returned by wait() when the default case ran
+  static constexpr size_t kDefault = std::numeric_limits<size_t>::max();
+  // Returned by wait_for() and wait_until() when the deadline passed
+  static constexpr size_t kTimedOut = kDefault - 1;
+
+  Select() = default;
+  // Disable copying and moving, channels hold a pointer while wait() blocks
+  Select(const Select&) = delete;
+  Select& operator=(const Select&) = delete;
+  Select(Select&&) = delete;
+  Select& operator=(Select&&) = delete;
+
+  ~Select() override = default;
+
+  /**
+   * @brief Adds a case that receives a value from the channel.
+   * @param ch The channel to receive from. Must outlive the Select.
+   * @param callback Called with the value, or with std::nullopt if the
+   * channel is closed and drained.
+   * @return *this, to chain the cases.
+   *
+   * On an unbuffered channel the case takes a value from try_send or a
+   * pending async_send at once. A blocked send() only pairs with it once
+   * wait() blocks, when the case counts as a waiting receiver.
+   */
+  template <typename T>
+  Select& on_receive(Channel<T>& ch,
+                     std::function<void(std::optional<T>)> callback);
+
+  /**
+   * @brief Adds a case that sends a value to the channel.
+   * @param ch The channel to send to. Must outlive the Select.
+   * @param value The value sent each time the case fires.
+   * @param callback Called after the value was sent, may be empty.
+   * @return *this, to chain the cases.
+   *
+   * The case is ready when a buffered channel has space or a receiver waits
+   * on an unbuffered channel. If the case is picked on a closed channel,
+   * wait() throws std::runtime_error, like send().
+   */
+  template <typename T>
+  Select& on_send(Channel<T>& ch, T value, std::function<void()> callback = {});
+
+  /**
+   * @brief Sets the case that runs when no other case is ready, which makes
+   * wait() non-blocking.
+   * @param callback Called when no case is ready, may be empty.
+   * @return *this, to chain the cases.
+   */
+  Select& on_default(std::function<void()> callback);
+
+  /**
+   * @brief Fires one ready case, blocking until there is one.
+   * @return The index of the fired case, or kDefault.
+   * @throws std::runtime_error if a send case on a closed channel is picked.
+   */
+  size_t wait() { return run(std::nullopt); }
+
+  /**
+   * @brief Like wait(), but gives up after the timeout.
+   * @return The index of the fired case, kDefault or kTimedOut.
+   */
+  template <typename Rep, typename Period>
+  size_t wait_for(const std::chrono::duration<Rep, Period>& timeout) {
+    return wait_until(
+        std::chrono::steady_clock::now() +
+        std::chrono::ceil<std::chrono::steady_clock::duration>(timeout));
+  }
+
+  /**
+   * @brief Like wait(), but gives up at the deadline.
+   * @return The index of the fired case, kDefault or kTimedOut.
+   */
+  size_t wait_until(std::chrono::steady_clock::time_point deadline) {
+    return run(deadline);
+  }
+
+  /**
+   * @brief Marks the case with the given id ready.
+   *
+   * @param id The index of the case.
+   * @note Called by Channel, should not be called directly.
+   */
+  void notify_ready(size_t id) override;
+
+ private:
+  struct Case {
+    virtual ~Case() = default;
+    // Receives or sends without blocking, true if the case fired
+    virtual bool try_fire() = 0;
+    // Runs the callback of a case that fired
+    virtual void run_callback() = 0;
+    virtual void arm(ReadyListener* listener, size_t id) = 0;
+    virtual void disarm(ReadyListener* listener) = 0;
+  };
+
+  template <typename T>
+  class ReceiveCase;
+  template <typename T>
+  class SendCase;
+
+  size_t run(std::optional<std::chrono::steady_clock::time_point> deadline);
+
+  /**
+   * @brief Registers with the channels and waits until a case fires or the
+   * deadline passes.
+   * @return The index of the fired case, std::nullopt on timeout.
+   */
+  std::optional<size_t> wait_ready(
+      std::optional<std::chrono::steady_clock::time_point> deadline);
+
+  /**
+   * @brief Tries the cases with the given ids in random order.
+   * @return The index of the first case that fired.
+   */
+  std::optional<size_t> try_cases(std::vector<size_t>& ids);
+
+  std::vector<std::unique_ptr<Case>> cases;
+  std::function<void()> default_callback;
+  bool has_default = false;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  // Guarded by mtx, ids of the cases whose channel reported a change
+  std::vector<size_t> ready;
+  std::vector<bool> queued;
+};
+
+template <typename T>
+class Select::ReceiveCase : public Case {
+ public:
+  ReceiveCase(Channel<T>& ch, std::function<void(std::optional<T>)> callback)
+      : ch(ch), callback(std::move(callback)) {}
+
+  bool try_fire() override {
+    value = ch.try_receive();
+    // A closed and drained channel is ready as well, with std::nullopt
+    return value || (ch.is_closed() && ch.is_empty());
+  }
+
+  void run_callback() override {
+    if (callback) {
+      callback(std::move(value));
+    }
+    value.reset();
+  }
+
+  void arm(ReadyListener* listener, size_t id) override {
+    ch.register_selector(listener, id, ReadyEvent::Receive);
+    // Registered first, so the value of a blocked sender is reported
+    ch.offer_receive();
+  }
+
+  void disarm(ReadyListener* listener) override {
+    ch.withdraw_receive();
+    ch.unregister_selector(listener);
+  }
+
+ private:
+  Channel<T>& ch;
+  std::function<void(std::optional<T>)> callback;
+  std::optional<T> value;
+};
+
+template <typename T>
+class Select::SendCase : public Case {
+ public:
+  SendCase(Channel<T>& ch, T value, std::function<void()> callback)
+      : ch(ch), value(std::move(value)), callback(std::move(callback)) {}
+
+  bool try_fire() override { return ch.try_select_send(value); }
+
+  void run_callback() override {
+    if (callback) {
+      callback();
+    }
+  }
+
+  void arm(ReadyListener* listener, size_t id) override {
+    ch.register_selector(listener, id, ReadyEvent::Send);
+  }
+
+  void disarm(ReadyListener* listener) override {
+    ch.unregister_selector(listener);
+  }
+
+ private:
+  Channel<T>& ch;
+  T value;
+  std::function<void()> callback;
+};
+
+template <typename T>
+Select& Select::on_receive(Channel<T>& ch,
+                           std::function<void(std::optional<T>)> callback) {
+  cases.push_back(std::make_unique<ReceiveCase<T>>(ch, std::move(callback)));
+  return *this;
+}
+
+template <typename T>
+Select& Select::on_send(Channel<T>& ch, T value,
+                        std::function<void()> callback) {
+  cases.push_back(
+      std::make_unique<SendCase<T>>(ch, std::move(value), std::move(callback)));
+  return *this;
+}
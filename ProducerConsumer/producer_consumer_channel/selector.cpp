@@ -1,30 +1,63 @@
 #include "selector.hpp"
 
-#include <algorithm>
+Selector::~Selector() {
+  std::vector<std::function<void()>> unregister;
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    for (Entry& entry : entries) {
+      if (!entry.done) {
+        unregister.push_back(std::move(entry.unregister));
+        mark_done(entry);
+      }
+    }
+  }
+  // Outside mtx: unregistering takes the channel mutex
+  for (auto& unregister_channel : unregister) {
+    unregister_channel();
+  }
+}
+
+void Selector::notify_detached(size_t id) {
+  std::unique_lock<std::mutex> lock(mtx);
+  mark_done(entries[id]);
+  cv.notify_all();
+}
 
 void Selector::select() {
   std::unique_lock<std::mutex> lock(mtx);
 
-  while (!stop_requested()) {
-    // Wait until a channel has data available or a stop is requested.
+  while (!stop_requested() && open_channels != 0) {
+    // Wait until a channel is ready, all of them are gone or a stop is
+    // requested.
     cv.wait(lock, [this] {
-      return stop_requested() ||
-             std::any_of(channels.begin(), channels.end(),
-                         [](const auto& ch) { return ch(); });
+      return stop_requested() || !ready.empty() || open_channels == 0;
     });
+    if (stop_requested() || ready.empty()) {
+      break;
+    }
 
-    // Process all channels that have data available
-    for (auto ch_it = channels.begin(); ch_it != channels.end();) {
-      if ((*ch_it)()) {
-        // Data processed, remove this channel from the list
-        ch_it = channels.erase(ch_it);
-      } else {
-        ++ch_it;
-      }
+    const size_t id = ready.front();
+    ready.pop_front();
+    // A send from now on queues the channel again
+    queued[id] = false;
+    Entry& entry = entries[id];
+    if (entry.done) {
+      continue;
     }
+    lock.unlock();
 
-    if (channels.empty()) {
-      break;
+    Progress progress = entry.poll();
+    if (progress == Progress::Closed) {
+      entry.unregister();
+    }
+
+    lock.lock();
+    if (progress == Progress::Closed) {
+      mark_done(entry);
+    } else if (progress == Progress::More && !queued[id]) {
+      // Back of the queue, the other ready channels go first
+      queued[id] = true;
+      ready.push_back(id);
     }
   }
-}
+}
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <functional>
 #include <mutex>
 #include <vector>
@@ -9,6 +11,39 @@
 template <typename T>
 class Channel;
 
+/**
+ * @brief What a channel reports to a registered ReadyListener.
+ */
+enum class ReadyEvent {
+  Receive,  // A value arrived, a receive may succeed
+  Send,     // A slot was freed or a receiver is waiting, a send may succeed
+};
+
+/**
+ * @brief Gets notified by the channels it is registered with.
+ *
+ * Channel calls notify_ready with its own mutex held, so an implementation
+ * must not call into a channel while holding the lock notify_ready takes.
+ */
+class ReadyListener {
+ public:
+  virtual ~ReadyListener() = default;
+
+  /**
+   * @brief Called on the registered event and when the channel closes.
+   * @param id The id the listener registered the channel with.
+   */
+  virtual void notify_ready(size_t id) = 0;
+
+  /**
+   * @brief Called when the channel is destroyed while still registered. The
+   * listener must not touch the channel afterwards. Listeners that are only
+   * registered while they wait, like Select, can ignore it.
+   * @param id The id the listener registered the channel with.
+   */
+  virtual void notify_detached([[maybe_unused]] size_t id) {}
+};
+
 /**
  * @brief A Selector class for non-blocking channel operations.
  *
@@ -16,8 +51,15 @@ class Channel;
  * simultaneously for incoming messages. It provides a select() method that
  * blocks until a message is received on any of the registered channels.
  *
+ * Every channel gets an id. A channel that receives a value or closes puts
+ * its id in the ready queue with notify_ready(), once until select() takes
+ * it, and select() only visits the channels in the queue, so a wakeup costs
+ * the same for one channel or a thousand.
+ *
+ * Channels can be added while select() runs, and can be destroyed before the
+ * selector, but not while select() is taking values from them.
  */
-class Selector {
+class Selector : public ReadyListener {
  public:
   Selector() : stop_flag_(false) {}
   // Disable copying and moving
@@ -26,8 +68,8 @@ class Selector {
   Selector(Selector&&) = delete;
   Selector& operator=(Selector&&) = delete;
 
-  // Destructor
-  ~Selector() = default;
+  // Destructor, unregisters from the channels that still exist
+  ~Selector() override;
 
   /**
    * @brief Adds a channel to the selector for receiving messages.
@@ -47,10 +89,10 @@ class Selector {
    * signaled to stop.
    *
    * This method runs a loop that:
-   * 1. Waits for data to become available on any channel or for a stop
-   * signal.
-   * 2. Processes all available data once woken up.
-   * 3. Removes channels that have been processed.
+   * 1. Waits for a channel id in the ready queue or for a stop signal.
+   * 2. Hands up to kBatch values of that channel to its callback, and puts
+   * the id back at the end of the queue if the channel has more.
+   * 3. Removes channels that have been closed and drained.
    * The loop continues until either all channels are processed or a stop is
    * requested.
    *
@@ -79,16 +121,62 @@ class Selector {
   }
 
   /**
-   * @brief Notifies the selector that data may be available on the channels.
+   * @brief Wakes select() without marking a channel ready.
    *
-   * Use Case: Notify the selector that data may be available on the channels.
+   * Use Case: Make select() re-check the stop flag.
    * Example: selector.notify();
-   * @note This function is meant for internal use and should not be called
-   * directly (unless you know what you're doing).
    */
-  void notify() { cv.notify_all(); }
+  void notify() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.notify_all();
+  }
+
+  /**
+   * @brief Marks the channel with the given id ready.
+   *
+   * @param id The id the channel was registered with.
+   * @note Called by Channel on send and close, should not be called
+   * directly.
+   */
+  void notify_detached(size_t id) override;
+
+  void notify_ready(size_t id) override {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (id < queued.size() && !queued[id]) {
+      queued[id] = true;
+      ready.push_back(id);
+      cv.notify_one();
+    }
+  }
 
  private:
+  // Values handed to one callback before other ready channels get a turn
+  static constexpr int kBatch = 64;
+
+  enum class Progress {
+    Drained,  // Nothing left for now
+    More,     // Stopped at kBatch, the channel may hold more
+    Closed,   // Closed and drained, remove the channel
+  };
+
+  struct Entry {
+    std::function<Progress()> poll;
+    std::function<void()> unregister;
+    // Guarded by mtx, set once the channel is unregistered or destroyed
+    bool done = false;
+  };
+
+  /**
+   * @brief Marks the entry done and removes it from the open channels.
+   * Called with mtx held.
+   */
+  void mark_done(Entry& entry) {
+    if (!entry.done) {
+      entry.done = true;
+      --open_channels;
+    }
+  }
+
   /**
    * @brief Checks if a stop has been requested.
    *
@@ -99,27 +187,50 @@ class Selector {
     return stop_flag_.test(std::memory_order_relaxed);
   }
 
-  std::vector<std::function<bool()>> channels;
   std::atomic_flag stop_flag_;
   std::mutex mtx;
   std::condition_variable cv;
+  // Guarded by mtx. Indexed by channel id, a deque so that add_receive does
+  // not move the entry select() is polling
+  std::deque<Entry> entries;
+  size_t open_channels = 0;
+  std::deque<size_t> ready;
+  std::vector<bool> queued;
 };
 
 template <typename T>
 void Selector::add_receive(Channel<T>& ch, std::function<void(T)> callback) {
+  size_t id = 0;
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    id = entries.size();
+    entries.push_back(
+        {[&ch, callback = std::move(callback)]() mutable {
+           for (int i = 0; i < kBatch; ++i) {
+             auto value = ch.try_receive();
+             if (!value) {
+               // Closed is only final once the channel is also drained
+               return ch.is_closed() && ch.is_empty() ? Progress::Closed
+                                                      : Progress::Drained;
+             }
+             callback(std::move(*value));
+           }
+           return Progress::More;
+         },
+         [&ch, this] { ch.unregister_selector(this); }});
+    ++open_channels;
+    // Not ready yet: a running select() must not poll the channel before
+    // sends notify the selector
+    queued.push_back(false);
+  }
+  // Outside mtx: the channel calls notify_ready with its own mutex held
+  ch.register_selector(this, id);
+
+  // Values may have been sent before the registration
   std::unique_lock<std::mutex> lock(mtx);
-  ch.register_selector(this);
-  // Add a lambda function to the channels list
-  channels.push_back([&ch, callback = std::move(callback), this]() mutable {
-    if (ch.is_closed()) {
-      ch.unregister_selector(this);
-      return true;  // Signal that this channel is done
-    }
-    auto value = ch.try_receive();
-    if (value) {
-      callback(*value);  // Call the callback with the received value
-      return false;
-    }
-    return false;
-  });
-}
\ No newline at end of file
+  if (!queued[id]) {
+    queued[id] = true;
+    ready.push_back(id);
+    cv.notify_one();
+  }
+}
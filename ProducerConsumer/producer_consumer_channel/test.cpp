@@ -0,0 +1,527 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "channel.hpp"
+#include "mpmc_ring.hpp"
+#include "select.hpp"
+
+#define CHECK(condition)                                                   \
+  do {                                                                     \
+    if (!(condition)) {                                                    \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #condition "\n"; \
+      return false;                                                        \
+    }                                                                      \
+  } while (0)
+
+using namespace std::chrono_literals;
+
+// Without a ready case the default case runs and wait() does not block
+bool testDefault() {
+  Channel<int> input(1);
+  Channel<int> output(1);
+  output.send(0);  // Full
+
+  bool received = false;
+  bool defaulted = false;
+  Select select;
+  select.on_receive<int>(input, [&](std::optional<int>) { received = true; })
+      .on_send(output, 1)
+      .on_default([&] { defaulted = true; });
+
+  CHECK(select.wait() == Select::kDefault);
+  CHECK(defaulted && !received);
+  CHECK(output.try_receive() == 0);
+  CHECK(output.is_empty());
+  return true;
+}
+
+// Ready receive and send cases fire with their index, one per wait()
+bool testReadyCases() {
+  Channel<int> input(2);
+  Channel<int> output(1);
+  input.send(7);
+
+  std::optional<int> value;
+  Select receive;
+  receive.on_receive<int>(input, [&](std::optional<int> v) { value = v; });
+  CHECK(receive.wait() == 0);
+  CHECK(value == 7);
+  CHECK(input.is_empty());
+
+  bool sent = false;
+  Select send;
+  send.on_receive<int>(input, [](std::optional<int>) {})
+      .on_send(output, 9, [&] { sent = true; });
+  CHECK(send.wait() == 1);
+  CHECK(sent);
+  CHECK(output.try_receive() == 9);
+  return true;
+}
+
+// A closed channel fires receive cases with std::nullopt and makes a picked
+// send case throw
+bool testClosed() {
+  Channel<int> ch(1);
+  ch.close();
+
+  std::optional<int> value = 0;
+  Select receive;
+  receive.on_receive<int>(ch, [&](std::optional<int> v) { value = v; });
+  CHECK(receive.wait_for(1s) == 0);
+  CHECK(!value);
+
+  Select send;
+  send.on_send(ch, 1);
+  bool threw = false;
+  try {
+    send.wait();
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  CHECK(threw);
+  return true;
+}
+
+// Nothing ready: wait_for gives up after the timeout
+bool testTimeout() {
+  Channel<int> input(1);
+  Channel<int> unbuffered;
+  Select select;
+  select.on_receive<int>(input, [](std::optional<int>) {})
+      .on_send(unbuffered, 1);  // No receiver
+
+  auto start = std::chrono::steady_clock::now();
+  CHECK(select.wait_for(20ms) == Select::kTimedOut);
+  CHECK(std::chrono::steady_clock::now() - start >= 20ms);
+  CHECK(select.wait_until(start) == Select::kTimedOut);
+  CHECK(input.is_empty());
+  return true;
+}
+
+// Two channels that always have a value: each case fires about half the
+// time, in contrast to a select that always tries the first case first
+bool testFairness() {
+  constexpr unsigned kRounds = 10'000;
+  Channel<int> first(kRounds);
+  Channel<int> second(kRounds);
+  for (unsigned i = 0; i < kRounds; ++i) {
+    first.send(1);
+    second.send(2);
+  }
+
+  unsigned counts[2] = {0, 0};
+  Select select;
+  select.on_receive<int>(first, [&](std::optional<int>) { ++counts[0]; })
+      .on_receive<int>(second, [&](std::optional<int>) { ++counts[1]; });
+  for (unsigned i = 0; i < kRounds; ++i) {
+    CHECK(select.wait() < 2);
+  }
+
+  CHECK(counts[0] + counts[1] == kRounds);
+  CHECK(counts[0] > kRounds * 45 / 100 && counts[1] > kRounds * 45 / 100);
+  return true;
+}
+
+// A blocked wait() wakes up for a send on one of many idle channels, and
+// does so quickly
+bool testWakeLatency() {
+  constexpr unsigned kRounds = 200;
+  std::vector<std::unique_ptr<Channel<int>>> channels;
+  for (int i = 0; i < 100; ++i) {
+    channels.push_back(std::make_unique<Channel<int>>(1));
+  }
+
+  std::atomic<unsigned> handled{0};
+  std::vector<std::chrono::steady_clock::duration> latencies;
+  std::atomic<std::chrono::steady_clock::rep> sent_at{0};
+  bool ordered = true;
+  {
+    std::jthread select_thread([&] {
+      Select select;
+      for (auto& ch : channels) {
+        select.on_receive<int>(*ch, [&](std::optional<int> value) {
+          latencies.push_back(
+              std::chrono::steady_clock::now().time_since_epoch() -
+              std::chrono::steady_clock::duration(sent_at.load()));
+          ordered = ordered && value == static_cast<int>(latencies.size());
+        });
+      }
+      for (unsigned i = 0; i < kRounds; ++i) {
+        select.wait();
+        handled.store(i + 1);
+      }
+    });
+
+    for (unsigned i = 0; i < kRounds; ++i) {
+      // Give the select time to block
+      std::this_thread::sleep_for(100us);
+      auto now = std::chrono::steady_clock::now().time_since_epoch();
+      sent_at.store(now.count());
+      channels[i % channels.size()]->send(static_cast<int>(i + 1));
+      while (handled.load() <= i) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  CHECK(ordered && latencies.size() == kRounds);
+  std::nth_element(latencies.begin(), latencies.begin() + kRounds / 2,
+                   latencies.end());
+  // Generous, the median wake takes microseconds
+  CHECK(latencies[kRounds / 2] < 5ms);
+  return true;
+}
+
+// A send case on an unbuffered channel fires for a receiver blocked in
+// receive(), and hands it the value
+bool testUnbufferedSend() {
+  Channel<int> ch;
+  std::optional<int> received;
+  {
+    std::jthread receiver([&] { received = ch.receive(); });
+
+    Select select;
+    select.on_send(ch, 5);
+    CHECK(select.wait_for(5s) == 0);
+  }
+  CHECK(received == 5);
+
+  // The receiver got its value, so there is nobody to send to
+  Select select;
+  select.on_send(ch, 6).on_default({});
+  CHECK(select.wait() == Select::kDefault);
+  return true;
+}
+
+// A receive case on an unbuffered channel pairs with a sender blocked in
+// send()
+bool testUnbufferedReceive() {
+  Channel<int> ch;
+  std::optional<int> value;
+  {
+    std::jthread sender([&] { ch.send(42); });
+
+    Select select;
+    select.on_receive<int>(ch, [&](std::optional<int> v) { value = v; });
+    CHECK(select.wait_for(5s) == 0);
+  }
+  CHECK(value == 42);
+
+  // A select next to a blocked receive() gets one of two values and the
+  // receiver the other, so neither is lost
+  std::optional<int> received;
+  {
+    std::jthread receiver([&] { received = ch.receive(); });
+    std::this_thread::sleep_for(10ms);
+    std::jthread sender([&] {
+      ch.send(7);
+      ch.send(8);
+    });
+    Select select;
+    select.on_receive<int>(ch, [&](std::optional<int> v) { value = v; });
+    CHECK(select.wait_for(5s) == 0);
+  }
+  CHECK(value && received && *value + *received == 15);
+  return true;
+}
+
+// A send case on a full channel fires once a receiver frees a slot
+bool testSendWakesOnSpace() {
+  Channel<int> ch(1);
+  ch.send(1);
+  std::jthread receiver([&] {
+    std::this_thread::sleep_for(10ms);
+    ch.receive();
+  });
+
+  Select select;
+  select.on_send(ch, 2);
+  CHECK(select.wait_for(5s) == 0);
+  CHECK(ch.try_receive() == 2);
+  return true;
+}
+
+// A channel destroyed before the selector drops out of it, select() then
+// has nothing left to wait for
+bool testSelectorOutlivesChannel() {
+  Selector selector;
+  int received = 0;
+  {
+    Channel<int> ch(2);
+    selector.add_receive<int>(ch, [&](int) { ++received; });
+    ch.send(1);
+  }
+  selector.select();
+  CHECK(received == 0);
+
+  Channel<int> live(2);
+  selector.add_receive<int>(live, [&](int) { ++received; });
+  live.send(2);
+  live.close();
+  selector.select();
+  CHECK(received == 1);
+  return true;
+}
+
+// Channels added while select() runs are served like the others
+bool testSelectorAddWhileRunning() {
+  Channel<int> first(4);
+  Channel<int> second(4);
+  std::atomic<int> sum{0};
+  Selector selector;
+  selector.add_receive<int>(first, [&](int value) { sum += value; });
+  {
+    std::jthread select_thread([&] { selector.select(); });
+    first.send(1);
+    while (sum.load() != 1) {
+      std::this_thread::yield();
+    }
+    selector.add_receive<int>(second, [&](int value) { sum += value; });
+    second.send(2);
+    while (sum.load() != 3) {
+      std::this_thread::yield();
+    }
+    first.close();
+    second.close();
+  }
+  CHECK(sum.load() == 3);
+
+  // A send racing with add_receive is not lost to a running select()
+  constexpr int kRounds = 2000;
+  Channel<int> keep_open(1);
+  Selector racing;
+  std::atomic<int> received{0};
+  racing.add_receive<int>(keep_open, [](int) {});
+  {
+    std::jthread select_thread([&] { racing.select(); });
+    std::deque<Channel<int>> channels;
+    std::atomic<Channel<int>*> next{nullptr};
+    std::jthread sender([&](std::stop_token stop) {
+      while (!stop.stop_requested()) {
+        if (Channel<int>* ch = next.exchange(nullptr)) {
+          ch->send(1);
+        }
+      }
+    });
+    for (int i = 0; i < kRounds; ++i) {
+      Channel<int>& ch = channels.emplace_back(1);
+      next.store(&ch);
+      racing.add_receive<int>(ch, [&](int value) { received += value; });
+      const auto deadline = std::chrono::steady_clock::now() + 5s;
+      while (received.load() != i + 1 &&
+             std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+      }
+      if (received.load() != i + 1) {
+        break;  // Lost, the check below reports it once select() is done
+      }
+    }
+    sender.request_stop();
+    sender.join();
+    for (Channel<int>& ch : channels) {
+      ch.close();
+    }
+    keep_open.close();
+  }
+  CHECK(received.load() == kRounds);
+  return true;
+}
+
+// Pending async operations complete each other without threads, far more
+// of them than any pool would have workers, in both orders
+bool testAsyncPending() {
+  constexpr int kPending = 64;
+  for (size_t capacity : {0, 1}) {
+    Channel<int> ch(capacity);
+    for (int round = 0; round < 2; ++round) {
+      std::vector<std::future<std::optional<int>>> receives;
+      std::vector<std::future<void>> sends;
+      for (int i = 0; i < kPending; ++i) {
+        if (round == 0) {
+          receives.push_back(ch.async_receive());
+        } else {
+          sends.push_back(ch.async_send(i));
+        }
+      }
+      for (int i = 0; i < kPending; ++i) {
+        if (round == 0) {
+          sends.push_back(ch.async_send(i));
+        } else {
+          receives.push_back(ch.async_receive());
+        }
+      }
+
+      int sum = 0;
+      for (auto& received : receives) {
+        CHECK(received.wait_for(5s) == std::future_status::ready);
+        sum += received.get().value_or(-1000);
+      }
+      for (auto& sent : sends) {
+        CHECK(sent.wait_for(5s) == std::future_status::ready);
+        sent.get();
+      }
+      CHECK(sum == kPending * (kPending - 1) / 2);
+    }
+  }
+
+  // Blocking counterparts complete pending operations too
+  Channel<int> ch;
+  auto received = ch.async_receive();
+  ch.send(1);
+  CHECK(received.wait_for(5s) == std::future_status::ready);
+  CHECK(received.get() == 1);
+  auto sent = ch.async_send(2);
+  CHECK(ch.receive() == 2);
+  CHECK(sent.wait_for(5s) == std::future_status::ready);
+
+  // Closing completes what is left
+  auto pending_send = ch.async_send(3);
+  Channel<int> empty;
+  auto pending_receive = empty.async_receive();
+  ch.close();
+  empty.close();
+  bool threw = false;
+  try {
+    pending_send.get();
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  CHECK(threw);
+  CHECK(pending_receive.get() == std::nullopt);
+  return true;
+}
+
+// A full one-slot ring refuses the next value on every lap, the stamps of a
+// full slot and of a free slot of the next lap used to coincide
+bool testRingCapacityOne() {
+  MPMCRing<int> ring(1);
+  for (int lap = 0; lap < 3; ++lap) {
+    CHECK(ring.try_emplace(lap));
+    CHECK(!ring.try_emplace(-1));
+    CHECK(ring.try_pop() == lap);
+    CHECK(!ring.try_pop());
+  }
+
+  Channel<int> ch(1);
+  CHECK(ch.try_send(1));
+  CHECK(!ch.try_send(2));
+  CHECK(ch.try_receive() == 1);
+  CHECK(!ch.try_receive());
+  return true;
+}
+
+// Batch ring operations stop at a full or empty ring and wrap around
+bool testRingBatches() {
+  for (size_t capacity : {1, 3, 8}) {
+    MPMCRing<int> ring(capacity);
+    std::vector<int> input(10);
+    std::iota(input.begin(), input.end(), 0);
+
+    for (int round = 0; round < 3; ++round) {
+      auto first = input.begin();
+      CHECK(ring.try_push_n(first, input.end()) == capacity);
+      CHECK(first == input.begin() + capacity);
+      CHECK(ring.try_push_n(first, input.end()) == 0);
+      CHECK(!ring.try_emplace(-1));
+
+      std::vector<int> output;
+      auto out = std::back_inserter(output);
+      CHECK(ring.try_pop_n(out, 2) == std::min<size_t>(capacity, 2));
+      CHECK(ring.try_pop_n(out, 100) ==
+            capacity - std::min<size_t>(capacity, 2));
+      CHECK(std::equal(output.begin(), output.end(), input.begin()));
+      CHECK(ring.try_pop_n(out, 100) == 0);
+    }
+  }
+  return true;
+}
+
+// send_range and receive_up_to keep the order, take what is there and give
+// up at the timeout
+bool testBatchChannel() {
+  Channel<int> ch(8);
+  std::vector<int> input{1, 2, 3, 4, 5};
+  ch.send_range(input.begin(), input.end());
+  CHECK(ch.size() == 5);
+
+  std::vector<int> output(3);
+  CHECK(ch.receive_up_to(output.begin(), output.size(), 1s) == 3);
+  CHECK((output == std::vector<int>{1, 2, 3}));
+  CHECK(ch.receive_up_to(output.begin(), output.size(), 1s) == 2);
+  CHECK(output[0] == 4 && output[1] == 5);
+
+  auto start = std::chrono::steady_clock::now();
+  CHECK(ch.receive_up_to(output.begin(), output.size(), 20ms) == 0);
+  CHECK(std::chrono::steady_clock::now() - start >= 20ms);
+
+  ch.close();
+  CHECK(ch.receive_up_to(output.begin(), output.size(), 1s) == 0);
+  bool threw = false;
+  try {
+    ch.send_range(input.begin(), input.end());
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  CHECK(threw);
+  return true;
+}
+
+// Batches larger than the capacity block and resume, every value arrives
+// once and in order
+bool testBatchProducerConsumer() {
+  constexpr int kValues = 100'000;
+  for (size_t capacity : {0, 1, 16, 1024}) {
+    Channel<int> ch(capacity);
+    std::vector<int> received;
+    received.reserve(kValues);
+    {
+      std::jthread consumer([&] {
+        std::vector<int> batch(100);
+        while (received.size() < kValues) {
+          size_t count = ch.receive_up_to(batch.begin(), batch.size(), 1s);
+          received.insert(received.end(), batch.begin(),
+                          batch.begin() + count);
+        }
+      });
+
+      std::vector<int> batch(257);
+      for (int sent = 0; sent < kValues;) {
+        int size = std::min<int>(batch.size(), kValues - sent);
+        std::iota(batch.begin(), batch.begin() + size, sent);
+        ch.send_range(batch.begin(), batch.begin() + size);
+        sent += size;
+      }
+    }
+
+    std::vector<int> expected(kValues);
+    std::iota(expected.begin(), expected.end(), 0);
+    CHECK(received == expected);
+  }
+  return true;
+}
+
+int main() {
+  bool passed = testDefault() && testReadyCases() && testClosed() &&
+                testTimeout() && testFairness() && testWakeLatency() &&
+                testUnbufferedSend() && testUnbufferedReceive() &&
+                testSendWakesOnSpace() &&
+                testSelectorOutlivesChannel() &&
+                testSelectorAddWhileRunning() && testAsyncPending() &&
+                testRingCapacityOne() && testRingBatches() &&
+                testBatchChannel() && testBatchProducerConsumer();
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
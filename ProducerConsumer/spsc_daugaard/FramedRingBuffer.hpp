@@ -0,0 +1,114 @@
+// Typed, variable length records over RingBuffer.
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "RingBuffer.hpp"
+
+// Every record is a header followed by a value of one of Types and optional
+// trailing bytes. The header carries the type id, the index of the type in
+// Types, and the length of value plus tail, so the reader does not need to
+// know what comes next. Dispatch hands the visitor a reference to the value
+// in the buffer, nothing is copied.
+//
+// Both sides issue the same PrepareWrite/PrepareRead sequence (header, then
+// value with its own alignment), so a record may wrap between header and
+// value like any other pair of writes.
+template <typename WaitPolicy, typename... Types>
+class FramedRingBuffer {
+  static_assert(sizeof...(Types) > 0, "FramedRingBuffer needs a type");
+
+ public:
+  struct RecordHeader {
+    uint32_t type;
+    uint32_t length;
+  };
+
+  explicit FramedRingBuffer(RingBuffer<WaitPolicy>& ringBuffer)
+      : m_RingBuffer(ringBuffer) {}
+
+  // Write a record and finish it.
+  template <typename T>
+  void Write(const T& value) {
+    Write(value, nullptr, 0);
+  }
+
+  // Write a record with tailSize bytes copied after the value.
+  template <typename T>
+  void Write(const T& value, const void* tail, size_t tailSize) {
+    static_assert((std::is_same_v<T, Types> || ...),
+                  "T is not one of the record types");
+    constexpr uint32_t type = TypeId<T>();
+    const size_t length = sizeof(T) + tailSize;
+    assert(length <= UINT32_MAX);
+
+    void* header =
+        m_RingBuffer.PrepareWrite(sizeof(RecordHeader), alignof(RecordHeader));
+    new (header) RecordHeader{type, static_cast<uint32_t>(length)};
+
+    void* dest = m_RingBuffer.PrepareWrite(length, alignof(T));
+    new (dest) T(value);
+    if (tailSize != 0)
+      memcpy(static_cast<char*>(dest) + sizeof(T), tail, tailSize);
+
+    m_RingBuffer.FinishWrite();
+  }
+
+  // Wait for the next record and call visitor(value) or, if it accepts one,
+  // visitor(value, tail) with the trailing bytes.
+  template <typename Visitor>
+  void Dispatch(Visitor&& visitor) {
+    const RecordHeader header = *static_cast<const RecordHeader*>(
+        m_RingBuffer.PrepareRead(sizeof(RecordHeader), alignof(RecordHeader)));
+    assert(header.type < sizeof...(Types));
+
+    VisitRecord(header, visitor, std::index_sequence_for<Types...>());
+    m_RingBuffer.FinishRead();
+  }
+
+ private:
+  template <typename T>
+  static constexpr uint32_t TypeId() {
+    constexpr bool kMatches[] = {std::is_same_v<T, Types>...};
+    for (uint32_t i = 0; i < sizeof...(Types); i++)
+      if (kMatches[i]) return i;
+    return sizeof...(Types);
+  }
+
+  template <typename Visitor, size_t... I>
+  void VisitRecord(const RecordHeader& header, Visitor& visitor,
+                   std::index_sequence<I...>) {
+    (void)((header.type == I &&
+            (VisitAs<std::tuple_element_t<I, std::tuple<Types...>>>(
+                 header.length, visitor),
+             true)) ||
+           ...);
+  }
+
+  template <typename T, typename Visitor>
+  void VisitAs(size_t length, Visitor& visitor) {
+    assert(length >= sizeof(T));
+    void* src = m_RingBuffer.PrepareRead(length, alignof(T));
+    T* value = std::launder(static_cast<T*>(src));
+
+    if constexpr (std::is_invocable_v<Visitor&, const T&,
+                                      std::span<const std::byte>>) {
+      const auto* tail = static_cast<const std::byte*>(src) + sizeof(T);
+      visitor(std::as_const(*value),
+              std::span<const std::byte>(tail, length - sizeof(T)));
+    } else {
+      visitor(std::as_const(*value));
+    }
+    std::destroy_at(value);
+  }
+
+  RingBuffer<WaitPolicy>& m_RingBuffer;
+};
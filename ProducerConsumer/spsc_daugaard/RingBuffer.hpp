@@ -0,0 +1,529 @@
+// Copyright 2018 Kaspar Daugaard. For educational purposes only.
+// See http://daugaard.org/blog/writing-a-fast-and-versatile-spsc-ring-buffer
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "RingBufferWait.hpp"
+
+#ifndef FORCE_INLINE
+#if defined(_MSC_VER)
+#define FORCE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define FORCE_INLINE inline
+#endif
+#endif
+
+const size_t RING_BUFFER_CACHE_LINE_SIZE = 64;
+
+// The writer and the reader wait for space or data according to WaitPolicy
+// (RingBufferWait.hpp): spinning on the other side's position, or sleeping
+// on a semaphore the other side signals only when asked to.
+template <typename WaitPolicy>
+class RingBuffer {
+ public:
+  // When FinishWrite/FinishRead publish their position. The position is
+  // published once any enabled limit is reached, a limit of zero is disabled.
+  // The default publishes on every call, with all limits disabled only
+  // Flush/FlushRead publish. A side about to block publishes first, so
+  // batching can not deadlock. Batching saves the release store and
+  // the shouldSignal exchange per message, at the cost of the other side
+  // seeing data (or free space) later.
+  struct PublishPolicy {
+    // Unpublished bytes, including alignment padding and the skipped tail
+    // at the end of the buffer.
+    size_t bytes = 0;
+    // Unpublished FinishWrite/FinishRead calls.
+    size_t messages = 1;
+    // Age of the oldest unpublished message. The next Finish call past it
+    // publishes, and a side waiting for the data (or the space) takes it
+    // once it is that old, so a side that goes idle without Flush holds it
+    // back no longer. Costs a clock read and a store per Finish call, plus
+    // a fence with a blocking WaitPolicy.
+    std::chrono::nanoseconds staleness{0};
+  };
+
+  // Set the publish policies. Call before the writer and reader start.
+  void SetPublishPolicy(const PublishPolicy& writer,
+                        const PublishPolicy& reader) {
+    m_Writer.policy = writer;
+    m_Reader.policy = reader;
+  }
+  void SetPublishPolicy(const PublishPolicy& policy) {
+    SetPublishPolicy(policy, policy);
+  }
+
+  // Allocate buffer space for writing.
+  FORCE_INLINE void* PrepareWrite(size_t size, size_t alignment);
+
+  // Finish written data, publish it if the writer policy says so.
+  FORCE_INLINE void FinishWrite();
+
+  // Publish all finished writes now.
+  void Flush();
+
+  // Write an element to the buffer.
+  template <typename T>
+  FORCE_INLINE void Write(const T& value) {
+    void* dest = PrepareWrite(sizeof(T), alignof(T));
+    new (dest) T(value);
+  }
+
+  // Write an array of elements to the buffer.
+  template <typename T>
+  FORCE_INLINE void WriteArray(const T* values, size_t count) {
+    void* dest = PrepareWrite(sizeof(T) * count, alignof(T));
+    for (size_t i = 0; i < count; i++)
+      new (static_cast<T*>(dest) + i) T(values[i]);
+  }
+
+  // Get read pointer. Size and alignment should match written data.
+  FORCE_INLINE void* PrepareRead(size_t size, size_t alignment);
+
+  // Finish reading, make buffer space available to writer if the reader
+  // policy says so.
+  FORCE_INLINE void FinishRead();
+
+  // Make the space of all finished reads available to writer now.
+  void FlushRead();
+
+  // Read an element from the buffer.
+  template <typename T>
+  FORCE_INLINE const T& Read() {
+    void* src = PrepareRead(sizeof(T), alignof(T));
+    return *static_cast<T*>(src);
+  }
+
+  // Read an array of elements from the buffer.
+  template <typename T>
+  FORCE_INLINE const T* ReadArray(size_t count) {
+    void* src = PrepareRead(sizeof(T) * count, alignof(T));
+    return static_cast<T*>(src);
+  }
+
+  RingBuffer() = default;
+  ~RingBuffer() { ReleaseMapping(); }
+
+  // Initialize. Buffer must have required alignment. Size must be a power of
+  // two.
+  void Initialize(void* buffer, size_t size) {
+    ReleaseMapping();
+    Reset();
+    m_Reader.buffer = m_Writer.buffer = static_cast<char*>(buffer);
+    m_Reader.size = m_Writer.size = m_Writer.end = size;
+  }
+
+#if defined(__linux__)
+  // How Create allocates the buffer.
+  struct AllocationOptions {
+    enum class Pages { Normal, TransparentHuge, Huge };
+    // Huge maps with MAP_HUGETLB and needs huge pages reserved by the
+    // system, TransparentHuge only advises the kernel.
+    Pages pages = Pages::Normal;
+    // NUMA node to bind the pages to, -1 leaves placement to the kernel.
+    int numaNode = -1;
+    // Touch every page up front so the first messages don't fault.
+    bool prefault = true;
+  };
+
+  // Create a ring buffer owning a page aligned buffer allocated with mmap.
+  // Size must be a power of two. Returns nullptr if the allocation or the
+  // NUMA binding fails.
+  static std::unique_ptr<RingBuffer> Create(size_t size,
+                                            const AllocationOptions& options);
+  static std::unique_ptr<RingBuffer> Create(size_t size) {
+    return Create(size, AllocationOptions());
+  }
+
+  // Initialize with an owned buffer mapped twice back to back, so the second
+  // mapping continues the first. Writes and reads never split and the tail
+  // of the buffer is never skipped. Size must be a power of two and a
+  // multiple of the page size. Returns false if the mapping fails.
+  bool InitializeMirrored(size_t size);
+#endif
+
+  void Reset() {
+    const PublishPolicy writerPolicy = m_Writer.policy;
+    const PublishPolicy readerPolicy = m_Reader.policy;
+    m_Reader = m_Writer = LocalState();
+    SetPublishPolicy(writerPolicy, readerPolicy);
+    m_ReaderShared.pos = m_WriterShared.pos = 0;
+    m_ReaderShared.staged = m_WriterShared.staged = 0;
+    m_ReaderShared.stagedDeadline = m_WriterShared.stagedDeadline = 0;
+  }
+
+ private:
+  FORCE_INLINE static size_t Align(size_t pos, size_t alignment) {
+#ifdef RINGBUFFER_DO_NOT_ALIGN
+    alignment = 1;
+#endif
+    return (pos + alignment - 1) & ~(alignment - 1);
+  }
+
+  void GetBufferSpaceToWriteTo(size_t& pos, size_t& end);
+  void GetBufferSpaceToReadFrom(size_t& pos, size_t& end);
+
+  void ReleaseMapping() {
+#if defined(__linux__)
+    if (m_Mapping) munmap(m_Mapping, m_MappingSize);
+#endif
+    m_Mapping = nullptr;
+    m_Mirrored = false;
+  }
+
+  // Writer and reader's local state.
+  struct alignas(RING_BUFFER_CACHE_LINE_SIZE) LocalState {
+    LocalState()
+        : buffer(nullptr),
+          pos(0),
+          end(0),
+          base(0),
+          size(0),
+          finished(0),
+          published(0),
+          pending(0) {}
+    char* buffer;
+    size_t pos;
+    size_t end;
+    size_t base;
+    size_t size;
+    // Position after the last Finish call and the last published one.
+    size_t finished;
+    size_t published;
+    // Finish calls since the last publish and when the first was made.
+    size_t pending;
+    std::chrono::steady_clock::time_point pendingSince;
+    PublishPolicy policy;
+  };
+
+  LocalState m_Writer;
+  LocalState m_Reader;
+
+  // Writer and reader's shared state.
+  struct alignas(RING_BUFFER_CACHE_LINE_SIZE) SharedState {
+    std::atomic<size_t> pos{0};
+    // Set by the other side before it sleeps on its semaphore.
+    std::atomic<bool> shouldSignal{false};
+    [[no_unique_address]] WaitPolicy semaphore;
+    // With a staleness cap: the finished position not published yet, and
+    // when the other side may take it without a publish.
+    std::atomic<size_t> staged{0};
+    std::atomic<std::chrono::steady_clock::rep> stagedDeadline{0};
+  };
+
+  static bool Finish(LocalState& local, SharedState& shared);
+
+  // Whether the other side may take shared.staged.
+  static bool Stale(const SharedState& shared) {
+    return std::chrono::steady_clock::now().time_since_epoch().count() >=
+           shared.stagedDeadline.load(std::memory_order_relaxed);
+  }
+
+  // Wait for staged data to go stale. The other side is not asked to
+  // signal, as it would not publish before its next Finish call.
+  static void WaitForStale(WaitPolicy& semaphore) {
+    if constexpr (WaitPolicy::kBlocking)
+      std::this_thread::yield();
+    else
+      semaphore.wait();
+  }
+
+  SharedState m_WriterShared;
+  SharedState m_ReaderShared;
+
+  // Set by InitializeMirrored, read-only while the buffer is in use.
+  void* m_Mapping = nullptr;
+  size_t m_MappingSize = 0;
+  bool m_Mirrored = false;
+};
+
+#if defined(__linux__)
+template <typename WaitPolicy>
+std::unique_ptr<RingBuffer<WaitPolicy>> RingBuffer<WaitPolicy>::Create(
+    size_t size, const AllocationOptions& options) {
+  // Default huge page size on x86-64 and AArch64
+  constexpr size_t kHugePageSize = size_t{2} << 20;
+  constexpr size_t kMaxNumaNodes = 1024;
+  constexpr size_t kMaskBits = sizeof(unsigned long) * CHAR_BIT;
+
+  if (size == 0 || (size & (size - 1)) != 0) return nullptr;
+  if (options.numaNode >= static_cast<int>(kMaxNumaNodes)) return nullptr;
+
+  const bool huge = options.pages == AllocationOptions::Pages::Huge;
+  const size_t pageSize =
+      huge ? kHugePageSize : static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t length = (size + pageSize - 1) & ~(pageSize - 1);
+
+  void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | (huge ? MAP_HUGETLB : 0),
+                       -1, 0);
+  if (mapping == MAP_FAILED) return nullptr;
+
+  // Owns the mapping from here on
+  auto ringBuffer = std::make_unique<RingBuffer>();
+  ringBuffer->Initialize(mapping, size);
+  ringBuffer->m_Mapping = mapping;
+  ringBuffer->m_MappingSize = length;
+
+  // Only advice, the kernel may ignore it
+  if (options.pages == AllocationOptions::Pages::TransparentHuge)
+    madvise(mapping, length, MADV_HUGEPAGE);
+
+  // Bind before the pages are touched, so they are allocated on the node
+  if (options.numaNode >= 0) {
+    const size_t node = static_cast<size_t>(options.numaNode);
+    unsigned long nodeMask[kMaxNumaNodes / kMaskBits] = {};
+    nodeMask[node / kMaskBits] |= 1UL << (node % kMaskBits);
+    // The kernel reads one bit less than maxnode
+    if (syscall(SYS_mbind, mapping, length, MPOL_BIND, nodeMask,
+                kMaxNumaNodes + 1, MPOL_MF_STRICT) != 0)
+      return nullptr;
+  }
+
+  if (options.prefault) memset(mapping, 0, length);
+  return ringBuffer;
+}
+
+template <typename WaitPolicy>
+bool RingBuffer<WaitPolicy>::InitializeMirrored(size_t size) {
+  const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  if (size == 0 || (size & (size - 1)) != 0 || size % pageSize != 0)
+    return false;
+
+  int fd = memfd_create("RingBuffer", MFD_CLOEXEC);
+  if (fd < 0) return false;
+
+  // Reserve both halves first, then map the same pages over each of them
+  void* mapping = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+    mapping = mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+                   -1, 0);
+  bool mapped = mapping != MAP_FAILED;
+  for (size_t half = 0; mapped && half < 2; half++) {
+    void* target = static_cast<char*>(mapping) + half * size;
+    mapped = mmap(target, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                  fd, 0) != MAP_FAILED;
+  }
+  close(fd);  // The mappings keep the memory alive
+
+  if (!mapped) {
+    if (mapping != MAP_FAILED) munmap(mapping, 2 * size);
+    return false;
+  }
+
+  Initialize(mapping, size);
+  m_Mapping = mapping;
+  m_MappingSize = 2 * size;
+  m_Mirrored = true;
+  return true;
+}
+#endif
+
+template <typename WaitPolicy>
+void* RingBuffer<WaitPolicy>::PrepareWrite(size_t size, size_t alignment) {
+  size_t pos = Align(m_Writer.pos, alignment);
+  size_t end = pos + size;
+  if (end > m_Writer.end) GetBufferSpaceToWriteTo(pos, end);
+  m_Writer.pos = end;
+  return m_Writer.buffer + pos;
+}
+
+// Record a Finish call, returns whether to publish.
+template <typename WaitPolicy>
+bool RingBuffer<WaitPolicy>::Finish(LocalState& local, SharedState& shared) {
+  local.finished = local.base + local.pos;
+  const PublishPolicy& policy = local.policy;
+  ++local.pending;
+  if (policy.messages != 0 && local.pending >= policy.messages) return true;
+  if (policy.bytes != 0 && local.finished - local.published >= policy.bytes)
+    return true;
+  if (policy.staleness.count() != 0) {
+    auto now = std::chrono::steady_clock::now();
+    if (local.pending == 1) {
+      local.pendingSince = now;
+      auto deadline = std::chrono::duration_cast<
+          std::chrono::steady_clock::duration>(
+          (now + policy.staleness).time_since_epoch());
+      shared.stagedDeadline.store(deadline.count(), std::memory_order_relaxed);
+    } else if (now - local.pendingSince >= policy.staleness) {
+      return true;
+    }
+    shared.staged.store(local.finished, std::memory_order_release);
+    if constexpr (WaitPolicy::kBlocking) {
+      // A side asleep can not watch the deadline, publish for it. Pairs
+      // with the shouldSignal store and staged load of the waiting side.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (shared.shouldSignal.load(std::memory_order_relaxed)) return true;
+    }
+  }
+  return false;
+}
+
+template <typename WaitPolicy>
+void RingBuffer<WaitPolicy>::FinishWrite() {
+  if (Finish(m_Writer, m_WriterShared)) Flush();
+}
+
+template <typename WaitPolicy>
+void RingBuffer<WaitPolicy>::Flush() {
+  m_Writer.published = m_Writer.finished;
+  m_Writer.pending = 0;
+  m_WriterShared.pos.store(m_Writer.published, std::memory_order_release);
+  if constexpr (WaitPolicy::kBlocking) {
+    if (m_WriterShared.shouldSignal.exchange(false))
+      m_ReaderShared.semaphore.signal();
+  }
+}
+
+template <typename WaitPolicy>
+void* RingBuffer<WaitPolicy>::PrepareRead(size_t size, size_t alignment) {
+  size_t pos = Align(m_Reader.pos, alignment);
+  size_t end = pos + size;
+  if (end > m_Reader.end) GetBufferSpaceToReadFrom(pos, end);
+  m_Reader.pos = end;
+  return m_Reader.buffer + pos;
+}
+
+template <typename WaitPolicy>
+void RingBuffer<WaitPolicy>::FinishRead() {
+  if (Finish(m_Reader, m_ReaderShared)) FlushRead();
+}
+
+template <typename WaitPolicy>
+void RingBuffer<WaitPolicy>::FlushRead() {
+  m_Reader.published = m_Reader.finished;
+  m_Reader.pending = 0;
+  m_ReaderShared.pos.store(m_Reader.published, std::memory_order_release);
+  if constexpr (WaitPolicy::kBlocking) {
+    if (m_ReaderShared.shouldSignal.exchange(false))
+      m_WriterShared.semaphore.signal();
+  }
+}
+
+template <typename WaitPolicy>
+void RingBuffer<WaitPolicy>::GetBufferSpaceToWriteTo(size_t& pos,
+                                                     size_t& end) {
+  if (m_Mirrored) {
+    // Continue in the first mapping instead of skipping the tail
+    if (pos >= m_Writer.size) {
+      pos -= m_Writer.size;
+      end -= m_Writer.size;
+      m_Writer.base += m_Writer.size;
+    }
+  } else if (end > m_Writer.size) {
+    end -= pos;
+    pos = 0;
+    m_Writer.base += m_Writer.size;
+  }
+  for (;;) {
+    size_t readerPos = m_ReaderShared.pos.load(std::memory_order_acquire);
+    size_t available = readerPos - m_Writer.base + m_Writer.size;
+    // Signed comparison (available can be negative)
+    if (static_cast<ptrdiff_t>(available) >= static_cast<ptrdiff_t>(end)) {
+      // Mirrored, the space may run on into the second mapping
+      m_Writer.end =
+          m_Mirrored ? available : std::min(available, m_Writer.size);
+      break;
+    }
+    // Space the reader finished with but holds back
+    size_t staged = m_ReaderShared.staged.load(std::memory_order_acquire);
+    available = staged - m_Writer.base + m_Writer.size;
+    if (static_cast<ptrdiff_t>(available) >= static_cast<ptrdiff_t>(end)) {
+      if (Stale(m_ReaderShared)) {
+        m_Writer.end =
+            m_Mirrored ? available : std::min(available, m_Writer.size);
+        break;
+      }
+      WaitForStale(m_WriterShared.semaphore);
+      continue;
+    }
+    // The reader may be waiting for our unpublished data
+    if (m_Writer.pending != 0) {
+      Flush();
+      continue;
+    }
+    if constexpr (!WaitPolicy::kBlocking) {
+      m_WriterShared.semaphore.wait();
+      continue;
+    }
+    m_ReaderShared.shouldSignal.store(true);
+    if (readerPos != m_ReaderShared.pos.load(std::memory_order_relaxed) ||
+        staged != m_ReaderShared.staged.load()) {
+      // Position changed after we requested signal, try to cancel
+      if (m_ReaderShared.shouldSignal.exchange(false))
+        continue;  // Request successfully cancelled
+    }
+    m_WriterShared.semaphore.wait();
+  }
+}
+
+template <typename WaitPolicy>
+void RingBuffer<WaitPolicy>::GetBufferSpaceToReadFrom(size_t& pos,
+                                                      size_t& end) {
+  if (m_Mirrored) {
+    if (pos >= m_Reader.size) {
+      pos -= m_Reader.size;
+      end -= m_Reader.size;
+      m_Reader.base += m_Reader.size;
+    }
+  } else if (end > m_Reader.size) {
+    end -= pos;
+    pos = 0;
+    m_Reader.base += m_Reader.size;
+  }
+  for (;;) {
+    size_t writerPos = m_WriterShared.pos.load(std::memory_order_acquire);
+    size_t available = writerPos - m_Reader.base;
+    // Signed comparison (available can be negative)
+    if (static_cast<ptrdiff_t>(available) >= static_cast<ptrdiff_t>(end)) {
+      m_Reader.end =
+          m_Mirrored ? available : std::min(available, m_Reader.size);
+      break;
+    }
+    // Data the writer finished but holds back
+    size_t staged = m_WriterShared.staged.load(std::memory_order_acquire);
+    available = staged - m_Reader.base;
+    if (static_cast<ptrdiff_t>(available) >= static_cast<ptrdiff_t>(end)) {
+      if (Stale(m_WriterShared)) {
+        m_Reader.end =
+            m_Mirrored ? available : std::min(available, m_Reader.size);
+        break;
+      }
+      WaitForStale(m_ReaderShared.semaphore);
+      continue;
+    }
+    // The writer may be waiting for space we have not released
+    if (m_Reader.pending != 0) {
+      FlushRead();
+      continue;
+    }
+    if constexpr (!WaitPolicy::kBlocking) {
+      m_ReaderShared.semaphore.wait();
+      continue;
+    }
+    m_WriterShared.shouldSignal.store(true);
+    if (writerPos != m_WriterShared.pos.load(std::memory_order_relaxed) ||
+        staged != m_WriterShared.staged.load()) {
+      // Position changed after we requested signal, try to cancel
+      if (m_WriterShared.shouldSignal.exchange(false))
+        continue;  // Request successfully cancelled
+    }
+    m_ReaderShared.semaphore.wait();
+  }
+}
@@ -0,0 +1,101 @@
+// Wait policies for RingBuffer.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <semaphore>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Jeff Preshing's semaphores:
+// https://github.com/preshing/cpp11-on-multicore/blob/master/common/sema.h
+#include "sema.h"
+
+// A wait policy is a semaphore: wait() blocks until signal(). A blocking
+// side first sets the other side's shouldSignal flag, and the other side
+// signals only if the flag is set, so signal() is off the fast path.
+//
+// With kBlocking = false the flag is never touched: the waiting side calls
+// wait() in a loop that re-reads the position, and Finish calls add nothing.
+
+// Spin on the position, the original v1 ring buffer.
+struct SpinWait {
+  static constexpr bool kBlocking = false;
+
+  void wait() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+  }
+  void signal() {}
+};
+
+// Operating system semaphore, the original v2 ring buffer.
+struct SemaphoreWait {
+  static constexpr bool kBlocking = true;
+
+  void wait() { semaphore.wait(); }
+  void signal() { semaphore.signal(); }
+
+  Semaphore semaphore;
+};
+
+// Spin on an atomic count for a while, then block on the operating system
+// semaphore.
+struct LightweightSemaphoreWait {
+  static constexpr bool kBlocking = true;
+
+  void wait() { semaphore.wait(); }
+  void signal() { semaphore.signal(); }
+
+  LightweightSemaphore semaphore;
+};
+
+// std::counting_semaphore, the original v2_std_semaphore ring buffer.
+struct StdSemaphoreWait {
+  static constexpr bool kBlocking = true;
+
+  void wait() { semaphore.acquire(); }
+  void signal() { semaphore.release(); }
+
+  std::counting_semaphore<> semaphore{0};
+};
+
+// Binary semaphore on one futex word, raw futex calls on Linux and
+// std::atomic wait/notify elsewhere.
+class FutexWait {
+ public:
+  static constexpr bool kBlocking = true;
+
+  void wait() {
+    while (m_State.exchange(0, std::memory_order_acquire) == 0) {
+#if defined(__linux__)
+      syscall(SYS_futex, &m_State, FUTEX_WAIT_PRIVATE, 0, nullptr, nullptr, 0);
+#else
+      m_State.wait(0, std::memory_order_relaxed);
+#endif
+    }
+  }
+
+  void signal() {
+    m_State.store(1, std::memory_order_release);
+#if defined(__linux__)
+    syscall(SYS_futex, &m_State, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    m_State.notify_one();
+#endif
+  }
+
+ private:
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "The futex word must be a plain 32 bit integer");
+  std::atomic<uint32_t> m_State{0};
+};
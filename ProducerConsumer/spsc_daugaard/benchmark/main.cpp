@@ -0,0 +1,126 @@
+// All RingBuffer wait policies through the same producer/consumer workloads.
+
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "RingBuffer.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr unsigned kSaturatedMessages = 2'000'000;
+constexpr unsigned kBursts = 2'000;
+constexpr unsigned kBurstSize = 16;
+constexpr auto kBurstPause = std::chrono::microseconds(50);
+
+struct Message {
+  uint64_t sequence;
+  int64_t sentNs;
+};
+
+alignas(RING_BUFFER_CACHE_LINE_SIZE) char buffer[1 << 16];
+
+std::chrono::nanoseconds threadCpuTime() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+struct Result {
+  double messagesPerSecond = 0;
+  double consumerCpu = 0;  // Share of the wall time the consumer was on a CPU
+  double medianLatencyUs = 0;
+  double p99LatencyUs = 0;
+  bool ordered = true;
+};
+
+// Producer writes as fast as it can, or in bursts with pauses between them.
+// The consumer checks the order and records the latency of every message.
+template <typename WaitPolicy>
+Result run(unsigned bursts, unsigned burstSize,
+           std::chrono::microseconds pause) {
+  auto ringBuffer = std::make_unique<RingBuffer<WaitPolicy>>();
+  ringBuffer->Initialize(buffer, sizeof(buffer));
+
+  const unsigned messages = bursts * burstSize;
+  std::vector<int64_t> latencies(messages);
+  Result result;
+
+  auto start = Clock::now();
+  std::thread consumer([&]() {
+    auto cpuStart = threadCpuTime();
+    for (unsigned i = 0; i < messages; i++) {
+      const Message& message = ringBuffer->template Read<Message>();
+      latencies[i] = nowNs() - message.sentNs;
+      result.ordered = result.ordered && message.sequence == i;
+      ringBuffer->FinishRead();
+    }
+    std::chrono::duration<double> cpu = threadCpuTime() - cpuStart;
+    std::chrono::duration<double> wall = Clock::now() - start;
+    result.consumerCpu = cpu / wall;
+  });
+
+  uint64_t sequence = 0;
+  for (unsigned burst = 0; burst < bursts; burst++) {
+    for (unsigned i = 0; i < burstSize; i++) {
+      ringBuffer->Write(Message{sequence++, nowNs()});
+      ringBuffer->FinishWrite();
+    }
+    if (pause.count() != 0) std::this_thread::sleep_for(pause);
+  }
+  consumer.join();
+
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  result.messagesPerSecond = messages / elapsed.count();
+
+  std::sort(latencies.begin(), latencies.end());
+  result.medianLatencyUs = latencies[messages / 2] / 1e3;
+  result.p99LatencyUs = latencies[messages * 99 / 100] / 1e3;
+  return result;
+}
+
+template <typename WaitPolicy>
+bool benchmark(const char* name) {
+  const Result saturated =
+      run<WaitPolicy>(1, kSaturatedMessages, std::chrono::microseconds(0));
+  const Result bursty = run<WaitPolicy>(kBursts, kBurstSize, kBurstPause);
+
+  printf("%-24s %8.2f M msg/s %5.0f%% cpu | %8.1f us %8.1f us %5.0f%% cpu\n",
+         name, saturated.messagesPerSecond / 1e6,
+         saturated.consumerCpu * 100, bursty.medianLatencyUs,
+         bursty.p99LatencyUs, bursty.consumerCpu * 100);
+  return saturated.ordered && bursty.ordered;
+}
+
+int main() {
+  printf("%-24s %26s | %34s\n", "", "saturated",
+         "bursts of 16 every 50 us");
+  printf("%-24s %26s | %34s\n", "wait policy", "throughput, consumer",
+         "latency p50, p99, consumer");
+
+  bool ordered = benchmark<SpinWait>("spin");
+  ordered = benchmark<SemaphoreWait>("semaphore") && ordered;
+  ordered = benchmark<LightweightSemaphoreWait>("lightweight semaphore") &&
+            ordered;
+  ordered = benchmark<StdSemaphoreWait>("std::counting_semaphore") && ordered;
+  ordered = benchmark<FutexWait>("futex") && ordered;
+
+  if (!ordered) {
+    printf("Messages arrived out of order\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
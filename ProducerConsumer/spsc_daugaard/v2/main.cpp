@@ -1,10 +1,17 @@
 // https://daugaard.org/blog/how-to-make-your-spsc-ring-buffer-do-nothing-more-efficiently/
 
+#include <chrono>
+#include <cstdint>
 #include <cstdio>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string_view>
 #include <mutex>
 #include <thread>
 
-#include "RingBuffer_v2.hpp"
+#include "FramedRingBuffer.hpp"
+#include "RingBuffer.hpp"
 
 constexpr int kMaxMessages = 10;
 
@@ -20,7 +27,10 @@ void consumeMessage([[maybe_unused]] const Message& message) {}
 
 constexpr unsigned int N = 4;
 
-RingBuffer ringBuffer;
+// The article's v2: sleep on an operating system semaphore
+using RingBufferV2 = RingBuffer<SemaphoreWait>;
+
+RingBufferV2 ringBuffer;
 
 std::mutex bufferMutex;
 Message buffer[N];
@@ -58,6 +68,271 @@ void consumer() {
   }
 }
 
+// Framed records: heterogeneous commands, the text command carries its
+// characters as trailing bytes.
+struct MoveCommand {
+  float x;
+  float y;
+};
+
+struct TextCommand {
+  uint32_t id;
+};
+
+struct StopCommand {};
+
+using CommandBuffer =
+    FramedRingBuffer<SemaphoreWait, MoveCommand, TextCommand, StopCommand>;
+
+template <typename... Visitors>
+struct Overloaded : Visitors... {
+  using Visitors::operator()...;
+};
+
+void demoFramed() {
+  alignas(RING_BUFFER_CACHE_LINE_SIZE) static char framedBuffer[256];
+  RingBufferV2 ring;
+  ring.Initialize(framedBuffer, sizeof(framedBuffer));
+  CommandBuffer commands(ring);
+
+  std::thread reader([&commands]() {
+    for (bool running = true; running;) {
+      commands.Dispatch(Overloaded{
+          [](const MoveCommand& move) {
+            printf("Move: %.1f %.1f\n", move.x, move.y);
+          },
+          [](const TextCommand& text, std::span<const std::byte> tail) {
+            printf("Text %u: %.*s\n", text.id, static_cast<int>(tail.size()),
+                   reinterpret_cast<const char*>(tail.data()));
+          },
+          [&running](const StopCommand&) { running = false; }});
+    }
+  });
+
+  constexpr std::string_view kTexts[] = {"hello", "variable length records",
+                                         ""};
+  for (uint32_t i = 0; i < 12; i++) {
+    if (i % 2 == 0) {
+      commands.Write(MoveCommand{.x = 1.0f * i, .y = -1.0f * i});
+    } else {
+      std::string_view text = kTexts[i % std::size(kTexts)];
+      commands.Write(TextCommand{.id = i}, text.data(), text.size());
+    }
+  }
+  commands.Write(StopCommand{});
+
+  reader.join();
+}
+
+// Publish policy benchmark: throughput of fixed size messages with
+// per-message publishing and with batched FinishWrite/FinishRead.
+constexpr unsigned kBenchMessages = 4'000'000;
+
+template <size_t Size>
+struct Payload {
+  uint64_t data[Size / sizeof(uint64_t)]{};
+};
+
+alignas(RING_BUFFER_CACHE_LINE_SIZE) char benchBuffer[1 << 16];
+
+volatile uint64_t benchmark_sink;
+
+template <typename T>
+double measureThroughput(const RingBufferV2::PublishPolicy& policy) {
+  auto bench = std::make_unique<RingBufferV2>();
+  bench->Initialize(benchBuffer, sizeof(benchBuffer));
+  bench->SetPublishPolicy(policy);
+
+  uint64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread reader([&bench, &checksum]() {
+    for (unsigned i = 0; i < kBenchMessages; i++) {
+      checksum += bench->Read<T>().data[0];
+      bench->FinishRead();
+    }
+    bench->FlushRead();
+  });
+
+  T message;
+  for (unsigned i = 0; i < kBenchMessages; i++) {
+    message.data[0] = i;
+    bench->Write(message);
+    bench->FinishWrite();
+  }
+  bench->Flush();
+
+  reader.join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (checksum != uint64_t{kBenchMessages} * (kBenchMessages - 1) / 2)
+    printf("Checksum mismatch\n");
+  return kBenchMessages / elapsed.count() / 1e6;
+}
+
+template <typename T>
+void benchmarkPublishPolicies() {
+  using namespace std::chrono_literals;
+  struct Case {
+    const char* name;
+    RingBufferV2::PublishPolicy policy;
+  };
+  const Case cases[] = {
+      {"every message", {}},
+      {"32 messages", {.bytes = 0, .messages = 32}},
+      {"4 KiB", {.bytes = 4096, .messages = 0}},
+      {"4 KiB or 20 us",
+       {.bytes = 4096, .messages = 0, .staleness = 20us}},
+  };
+
+  for (const Case& c : cases) {
+    printf("%3zu byte messages, publish %-15s %8.2f M msg/s\n", sizeof(T),
+           c.name, measureThroughput<T>(c.policy));
+  }
+}
+
+// A writer that finishes a message and goes idle without Flush: the reader
+// gets the message once it is as old as the staleness cap, not when the
+// writer wakes up again.
+void demoStalenessCap() {
+  using namespace std::chrono_literals;
+  constexpr auto kIdle = 100ms;
+  auto bench = std::make_unique<RingBufferV2>();
+  bench->Initialize(benchBuffer, sizeof(benchBuffer));
+  bench->SetPublishPolicy({.bytes = 4096, .messages = 0, .staleness = 1ms});
+
+  std::chrono::steady_clock::time_point finished;
+  std::chrono::duration<double, std::milli> delay{};
+  std::thread reader([&bench, &finished, &delay]() {
+    benchmark_sink = bench->Read<Payload<8>>().data[0];
+    delay = std::chrono::steady_clock::now() - finished;
+    bench->FinishRead();
+    bench->FlushRead();
+  });
+
+  finished = std::chrono::steady_clock::now();
+  bench->Write(Payload<8>{});
+  bench->FinishWrite();
+  std::this_thread::sleep_for(kIdle);
+  bench->Flush();
+  reader.join();
+
+  printf("Staleness cap 1 ms, writer idle %lld ms: read after %.2f ms\n",
+         static_cast<long long>(kIdle.count()), delay.count());
+}
+
+// Mixed size messages: a plain buffer skips the tail that does not fit the
+// next message, a mirrored buffer never does. Wasted bytes are the gaps
+// between consecutive messages as seen by the writer.
+constexpr size_t kMixedSizes[] = {16, 48, 200, 1000, 3000, 24, 520, 7000};
+constexpr size_t kMixedBufferSize = 1 << 16;
+
+alignas(RING_BUFFER_CACHE_LINE_SIZE) char mixedBuffer[kMixedBufferSize];
+
+void measureMixed(const char* name, RingBufferV2& bench) {
+  const size_t kSizesCount = std::size(kMixedSizes);
+  uint64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread reader([&bench, &checksum, kSizesCount]() {
+    for (unsigned i = 0; i < kBenchMessages; i++) {
+      const size_t size = kMixedSizes[i % kSizesCount];
+      auto* message =
+          static_cast<const uint64_t*>(bench.PrepareRead(size, 8));
+      checksum += message[0] + message[size / 8 - 1];
+      bench.FinishRead();
+    }
+  });
+
+  size_t payload = 0;
+  size_t wasted = 0;
+  uintptr_t expected = 0;
+  for (unsigned i = 0; i < kBenchMessages; i++) {
+    const size_t size = kMixedSizes[i % kSizesCount];
+    auto* message = static_cast<uint64_t*>(bench.PrepareWrite(size, 8));
+    message[0] = i;
+    message[size / 8 - 1] = i;
+    bench.FinishWrite();
+
+    // Gap modulo the buffer size, the second mapping aliases the first
+    const uintptr_t address = reinterpret_cast<uintptr_t>(message);
+    if (i != 0) wasted += (address - expected) % kMixedBufferSize;
+    expected = address + size;
+    payload += size;
+  }
+
+  reader.join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (checksum != uint64_t{kBenchMessages} * (kBenchMessages - 1))
+    printf("Checksum mismatch\n");
+  printf("Mixed sizes, %-9s %8.2f M msg/s %8.0f MB/s, %5.2f%% wasted\n",
+         name, kBenchMessages / elapsed.count() / 1e6,
+         payload / elapsed.count() / 1e6,
+         100.0 * wasted / (payload + wasted));
+}
+
+void benchmarkMirrored() {
+  {
+    auto bench = std::make_unique<RingBufferV2>();
+    bench->Initialize(mixedBuffer, sizeof(mixedBuffer));
+    measureMixed("plain", *bench);
+  }
+#if defined(__linux__)
+  {
+    auto bench = std::make_unique<RingBufferV2>();
+    if (!bench->InitializeMirrored(kMixedBufferSize)) {
+      printf("Mirrored mapping failed\n");
+      return;
+    }
+    measureMixed("mirrored", *bench);
+  }
+#endif
+}
+
+#if defined(__linux__)
+// First pass through a fresh buffer, one thread alternating writes and reads
+// so every page is touched once. Without prefaulting each new page faults
+// on the first message that lands on it.
+void measureFirstPass(const char* name,
+                      const RingBufferV2::AllocationOptions& options) {
+  constexpr size_t kSize = size_t{4} << 20;
+  auto start = std::chrono::steady_clock::now();
+  auto bench = RingBufferV2::Create(kSize, options);
+  if (!bench) {
+    printf("First pass, %-22s allocation failed\n", name);
+    return;
+  }
+  auto created = std::chrono::steady_clock::now();
+
+  Payload<64> message;
+  for (size_t i = 0; i < kSize / sizeof(message); i++) {
+    message.data[0] = i;
+    bench->Write(message);
+    bench->FinishWrite();
+    benchmark_sink = bench->Read<Payload<64>>().data[0];
+    bench->FinishRead();
+  }
+  auto finished = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::micro> create = created - start;
+  std::chrono::duration<double, std::micro> pass = finished - created;
+  printf("First pass, %-22s create %8.0f us, messages %8.0f us\n", name,
+         create.count(), pass.count());
+}
+
+void benchmarkAllocation() {
+  using Pages = RingBufferV2::AllocationOptions::Pages;
+  measureFirstPass("no prefault", {.prefault = false});
+  measureFirstPass("prefault", {});
+  measureFirstPass("transparent huge pages", {.pages = Pages::TransparentHuge});
+  measureFirstPass("huge pages", {.pages = Pages::Huge});
+  measureFirstPass("NUMA node 0", {.numaNode = 0});
+}
+#endif
+
 int main() {
   ringBuffer.Initialize(buffer, sizeof(buffer));
 
@@ -67,5 +342,17 @@ int main() {
   t1.join();
   t2.join();
 
+  demoFramed();
+
+  benchmarkPublishPolicies<Payload<8>>();
+  benchmarkPublishPolicies<Payload<64>>();
+  demoStalenessCap();
+
+  benchmarkMirrored();
+
+#if defined(__linux__)
+  benchmarkAllocation();
+#endif
+
   return EXIT_SUCCESS;
 }
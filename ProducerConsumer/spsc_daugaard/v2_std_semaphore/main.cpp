@@ -4,7 +4,7 @@
 #include <mutex>
 #include <thread>
 
-#include "RingBuffer_v2.hpp"
+#include "RingBuffer.hpp"
 
 constexpr int kMaxMessages = 10;
 
@@ -20,7 +20,7 @@ void consumeMessage([[maybe_unused]] const Message& message) {}
 
 constexpr unsigned int N = 4;
 
-RingBuffer ringBuffer;
+RingBuffer<StdSemaphoreWait> ringBuffer;
 
 std::mutex bufferMutex;
 Message buffer[N];